@@ -1,11 +1,41 @@
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700 // realpath
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <sys/stat.h>
 #include <ctype.h>
+#include <errno.h>
+#include <dirent.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PHOTON_X86_KERNELS
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define PHOTON_NEON_KERNELS
+#include <arm_neon.h>
+#endif
+#ifdef PHOTON_STREAMING_DECODE
+#include <setjmp.h>
+#include <jpeglib.h>
+#include <png.h>
+#endif
 
 #define WINDOW_WIDTH 800
 #define WINDOW_HEIGHT 600
@@ -13,6 +43,88 @@
 #define MAX_PATH_LENGTH 4096
 #define MAX_FILENAME_LENGTH 256
 #define MAX_FILE_SIZE (100 * 1024 * 1024) // 100MB limit
+#define MAX_IMAGE_DIMENSION 32768
+#define MAX_MIP_LEVELS 8 // Full resolution plus 2x box-filtered reductions
+#define MIP_MIN_DIMENSION 512 // No further reductions once the longer side is this small
+#define STREAM_MIN_PIXELS (4 * 1024 * 1024) // Smaller images decode fast enough without previews
+#define STREAM_NOTIFY_INTERVAL_MS 33 // Minimum gap between partial-frame uploads
+#define STREAM_ROW_BATCH 16 // Rows decoded per lock of the shared surface
+#define PIXEL_POOL_MIN_SHIFT 16 // Smallest bucket holds 64KB
+#define PIXEL_POOL_STEPS 4 // Buckets per doubling, so rounding up wastes at most a quarter
+#define PIXEL_POOL_BUCKETS (15 * PIXEL_POOL_STEPS + 1) // 64KB to 2GB
+#define PIXEL_POOL_IDLE_SHARE 4 // Idle buffers may hold up to this fraction of the CPU budget
+#define MEMORY_DEFAULT_CPU_BUDGET_MB 2048 // Decoded surfaces waiting for upload, plus idle pool buffers
+#define MEMORY_DEFAULT_GPU_BUDGET_MB 1024 // Textures held by the texture cache
+#define MEMORY_MIN_BUDGET_MB 16
+#define MEMORY_MAX_BUDGET_MB (1024L * 1024)
+#define PIXEL_BUFFER_HEADER 64 // Multiple of the malloc alignment, so pixels stay aligned
+#define MAX_WORKER_THREADS 64
+#define PARALLEL_DECODE_MIN_PIXELS (8 * 1024 * 1024) // Below this, thread handoff outweighs the split
+#define PARALLEL_BANDS_PER_THREAD 2 // Extra bands even out differences in entropy-coded density
+#define THUMBNAIL_SIZE 256 // Longest side of cached thumbnails
+#define DECODE_MAX_REDUCTION 8 // Largest downscale-on-decode factor; libjpeg's DCT scaling stops at 1/8
+#define COLOR_CURVE_SIZE 1024 // Samples per tone curve
+#define COLOR_LUT_SIZE 33 // Grid nodes per axis of a transform LUT
+#define COLOR_LUT_CACHE 4 // Source/display profile pairs kept with their LUTs
+#define COLOR_MAX_PROFILE_BYTES (4 * 1024 * 1024)
+#define COLOR_NODE_B 4 // Float offsets between neighbouring LUT nodes along blue, green and red
+#define COLOR_NODE_G (COLOR_LUT_SIZE * COLOR_NODE_B)
+#define COLOR_NODE_R (COLOR_LUT_SIZE * COLOR_NODE_G)
+#define THUMBNAIL_MAGIC "PHTB"
+#define THUMBNAIL_VERSION 3 // 2 dropped the metadata record, 3 holds source pixels; older entries are rewritten
+#define THUMBNAIL_HEADER_CAPACITY (MAX_PATH_LENGTH + 64)
+#define GRID_CELL_WIDTH 176
+#define GRID_CELL_HEIGHT 200
+#define GRID_THUMBNAIL_BOX 160 // Thumbnails are fitted into this square inside each cell
+#define GRID_ATLAS_SIZE 2048
+#define GRID_ATLAS_COUNT 4
+#define GRID_MAX_SLOTS (GRID_ATLAS_COUNT * (GRID_ATLAS_SIZE / THUMBNAIL_SIZE) * (GRID_ATLAS_SIZE / THUMBNAIL_SIZE))
+#define GRID_SCROLL_STEP 60 // Pixels per mouse wheel notch
+#define ZOOM_MIN 0.01f
+#define ZOOM_MAX 64.0f
+#define ZOOM_KEY_STEP 1.2f
+#define ZOOM_WHEEL_STEP 1.1f
+#define ZOOM_NEAREST_THRESHOLD 4.0f // Magnifications above this show texels as hard-edged blocks
+#define DRAG_THRESHOLD_PX 4 // A press must travel this far before it pans, so click jitter keeps fit mode
+#define PAN_KEY_DIVISOR 8 // Arrow keys move the image by this fraction of the window
+#define ANIMATION_STEP_MS 8.0 // Fixed simulation step, independent of the display rate
+#define ANIMATION_EASING 0.2f // Fraction of the remaining zoom/pan distance covered per step
+#define ANIMATION_MAX_STEPS 25 // Catch-up after a stall is dropped rather than replayed
+#define ANIMATION_RING_FRAMES 8 // Decoded GIF frames buffered ahead of playback
+#define ANIMATION_RING_BYTES (64 * 1024 * 1024) // Large canvases get a shorter ring, down to two frames
+#define ANIMATION_ATLAS_SIZE 2048 // Animations whose frames all fit one texture this size loop from it
+#define ANIMATION_MIN_DELAY_MS 20 // Shorter GIF delays play at the default, as browsers do
+#define ANIMATION_DEFAULT_DELAY_MS 100
+#define ANIMATION_RETRY_MS 4 // Re-check interval when a frame is due but not decoded yet
+#define SLIDESHOW_DEFAULT_INTERVAL_MS 5000
+#define SLIDESHOW_MIN_INTERVAL_MS 100
+#define SLIDESHOW_MAX_INTERVAL_MS (24L * 60 * 60 * 1000)
+#define SLIDESHOW_MAX_CROSSFADE_MS 10000
+#define RESULT_RING_SLOTS 32 // Power of two; the loader waits for a free slot when the main thread falls behind
+#define RESULT_RING_RETRY_MS 2
+#define UPLOAD_BUDGET_MS 6.0 // Main-thread time per frame for uploading finished loads
+#define EVENT_WAIT_TIMEOUT_MS 100 // Idle wake-up interval when nothing needs redrawing
+#define WATCH_SETTLE_MS 250 // Quiet time before changed files are re-read; writers may still be appending
+#define WATCH_MAX_PENDING 256 // Distinct changed names held per batch; more resyncs the listing instead
+#define WATCH_BUFFER_BYTES (64 * 1024) // ReadDirectoryChangesW's limit on network shares
+#define PREFETCH_RADIUS 2 // Neighbours decoded ahead on each side of the current image
+#define TEXTURE_CACHE_SIZE 8 // Must hold the current image plus both prefetch windows
+#define MAX_INFO_LINES 12
+#define MAX_INFO_LINE_LENGTH 300
+#define GLYPH_WIDTH 8
+#define GLYPH_HEIGHT 16
+#define GLYPH_FIRST 32 // Printable ASCII only
+#define GLYPH_COUNT 95
+#define GLYPH_ATLAS_COLUMNS 16
+#define GLYPH_BATCH_CAPACITY 1024 // Glyphs per draw call
+#define STATS_WINDOW 512 // Most recent samples per stage behind the percentiles
+#define STATS_DEFAULT_CSV "photon_stats.csv"
+#define BENCH_DEFAULT_CORPUS "bench_corpus"
+#define BENCH_DEFAULT_FRAMES 60
+#define BENCH_LOAD_ITERATIONS 5
+#define BENCH_MAX_FRAMES 10000
+#define SCAN_BATCH_FILES 4096 // Paths gathered per parallel pass, so output starts before the walk ends
+#define SCAN_MAX_DEPTH 64
 
 #ifdef _WIN32
 #undef main
@@ -27,21 +139,65 @@ typedef enum {
     SECURITY_ERROR_MEMORY_ALLOCATION
 } SecurityResult;
 
+// Read-only view of a whole file, shared by size validation, decode and metadata
 typedef struct {
-    SDL_Window *window;
-    SDL_Renderer *renderer;
-    SDL_Texture *image_texture;
-    int window_width;
-    int window_height;
-    int image_width;
-    int image_height;
-    int running;
-    float zoom;
-    int pan_x;
-    int pan_y;
-    int fit_to_window;
-    int show_info;
-} App;
+    const Uint8 *data;
+    size_t size;
+    time_t creation_time;
+    time_t modification_time;
+#ifdef _WIN32
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+// Recyclable pixel storage; the header sits in front of the pixels it describes
+typedef struct PixelBuffer {
+    struct PixelPool *pool;
+    struct PixelBuffer *next;
+    size_t capacity;
+    int bucket;
+} PixelBuffer;
+
+typedef struct PixelPool {
+    SDL_mutex *lock;
+    PixelBuffer *free_lists[PIXEL_POOL_BUCKETS];
+    size_t idle_bytes;
+    size_t max_idle_bytes;
+} PixelPool;
+
+// Bytes of decoded images held in CPU surfaces and GPU textures, against caps set at startup.
+// The CPU side is counted in KiB by the loader thread as it decodes; the GPU side lives in
+// the texture cache and is only touched on the main thread.
+typedef struct {
+    size_t cpu_cap;
+    size_t gpu_cap;
+    SDL_atomic_t cpu_kib;
+    int evictions;
+    int downscaled;
+} MemoryBudget;
+
+// Thumbnails on disk, one file per image, keyed by path + mtime + size
+typedef struct {
+    char directory[MAX_PATH_LENGTH];
+    int enabled;
+} ThumbnailCache;
+
+// Runs task(context, 0..count-1) across persistent threads plus the calling thread
+typedef void (*WorkerTask)(void *context, int index);
+
+typedef struct {
+    SDL_Thread *threads[MAX_WORKER_THREADS];
+    int thread_count;
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    SDL_cond *done;
+    WorkerTask task;
+    void *context;
+    int next_index;
+    int task_count;
+    int remaining;
+    int quit;
+} WorkerPool;
 
 typedef struct {
     char filename[256];
@@ -51,10 +207,438 @@ typedef struct {
     long file_size;
     int bits_per_pixel;
     char format[32];
+    char color_space[48]; // Embedded profile name, EXIF color space or "sRGB"; empty when untagged
+    int orientation; // EXIF orientation 1-8, applied when drawing; 1 when the file has none
+    char camera_make[32];
+    char camera_model[48];
+    time_t capture_time; // EXIF DateTimeOriginal as local time, 0 when absent
     time_t creation_time;
     time_t modification_time;
 } ImageMetadata;
 
+// TIFF structure inside a JPEG's APP1 Exif segment; offsets are relative to the TIFF header
+typedef struct {
+    const Uint8 *data;
+    size_t size;
+    int big_endian;
+} ExifReader;
+
+// Matrix/TRC RGB profile: tone curves to linear light, then a matrix to D50 XYZ
+typedef struct {
+    Uint32 id; // Hash of the ICC data, or a fixed id for the built-in profiles
+    float to_xyz[3][3];
+    float curves[3][COLOR_CURVE_SIZE];
+} ColorProfile;
+
+// Source-to-display transform sampled on a COLOR_LUT_SIZE^3 grid, RGBx floats per node
+typedef struct {
+    Uint32 source_id;
+    Uint32 display_id;
+    float *nodes;
+    int identity; // Within half a code value of doing nothing, so images are left alone
+    Uint32 last_used;
+} ColorLut;
+
+// Display profile plus the LUTs built against it. The main thread swaps the display profile;
+// the loader thread builds and applies LUTs.
+typedef struct {
+    SDL_mutex *lock;
+    ColorProfile display;
+    char display_name[48];
+    ColorLut luts[COLOR_LUT_CACHE];
+    Uint32 clock;
+} ColorManager;
+
+// Timed stages of a load and of a frame; the first four run on the loader thread
+typedef enum {
+    STATS_STAGE_OPEN,
+    STATS_STAGE_METADATA,
+    STATS_STAGE_DECODE,
+    STATS_STAGE_CONVERT,
+    STATS_STAGE_UPLOAD,
+    STATS_STAGE_RENDER,
+    STATS_STAGE_PRESENT,
+    STATS_STAGE_COUNT
+} StatsStage;
+
+// Rolling window per stage for percentiles, plus session totals for the CSV dump
+typedef struct {
+    float samples[STATS_STAGE_COUNT][STATS_WINDOW];
+    int next[STATS_STAGE_COUNT];
+    long count[STATS_STAGE_COUNT];
+    double total_ms[STATS_STAGE_COUNT];
+    double max_ms[STATS_STAGE_COUNT];
+    char csv_path[MAX_PATH_LENGTH];
+} FrameStats;
+
+typedef struct {
+    long count;
+    double mean_ms;
+    double p50_ms;
+    double p99_ms;
+    double max_ms;
+} StatsSummary;
+
+typedef enum {
+    LOADER_EVENT_COMPLETE,
+    LOADER_EVENT_PROGRESS,
+    LOADER_EVENT_THUMBNAIL
+} LoaderEventCode;
+
+typedef struct {
+    LoaderEventCode code;
+    void *data;
+} ResultSlot;
+
+// Single-producer/single-consumer ring from the loader thread to the main thread. Only the
+// loader advances head and only the main thread advances tail, so neither side takes a lock.
+// One SDL event wakes the main loop per batch; the results themselves never enter the queue.
+typedef struct {
+    ResultSlot slots[RESULT_RING_SLOTS];
+    SDL_atomic_t head;
+    SDL_atomic_t tail;
+    SDL_atomic_t wake_pending;
+    SDL_atomic_t closed; // Set on shutdown so a producer waiting for space gives up
+    Uint32 event_type;
+} ResultRing;
+
+// Partially decoded image shared between the loader thread and the main thread.
+// The loader writes pixels under lock; the main thread uploads the dirty rows under lock.
+typedef struct {
+    SDL_mutex *lock;
+    ResultRing *results;
+    SDL_atomic_t notify_pending;
+    Uint32 last_notify;
+    char filepath[MAX_PATH_LENGTH];
+    int width;
+    int height;
+    SDL_Surface *preview;
+    SDL_Surface *surface;
+    int rows_visible;
+    int dirty_top;
+    int dirty_bottom;
+    int orientation; // EXIF orientation the finished image will be drawn with
+} ProgressiveImage;
+
+typedef struct {
+    char filepath[MAX_PATH_LENGTH];
+    int prefetch;
+    ProgressiveImage *stream;
+    SecurityResult result;
+    SDL_Surface *levels[MAX_MIP_LEVELS];
+    int level_count;
+    ImageMetadata metadata;
+    double stage_ms[STATS_STAGE_COUNT]; // Loader-side stages; zero when a stage did not run
+    MemoryBudget *memory;
+    size_t cpu_bytes; // Charged to memory until the result is freed
+    int full_width; // Real image size when decoded reduced or when levels over the GPU budget were dropped
+    int full_height;
+    int skipped_levels;
+    int reduced; // Decoded at a fraction of full size for fit-to-window viewing
+} LoadResult;
+
+typedef struct {
+    char filepath[MAX_PATH_LENGTH];
+    int index;
+    SDL_Surface *thumbnail;
+    int orientation; // EXIF orientation, applied when the grid draws the unrotated thumbnail
+} ThumbnailResult;
+
+typedef struct {
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *wake;
+    ResultRing results;
+    PixelPool *pool;
+    WorkerPool *workers;
+    ThumbnailCache *thumbnails;
+    MemoryBudget *memory;
+    ColorManager *color;
+    char pending_path[MAX_PATH_LENGTH];
+    int has_pending;
+    int pending_full; // The pending image replaces a reduced decode, so it is decoded at full size
+    int reduce_width; // Fit-to-window target for reduced decodes, 0 for full size
+    int reduce_height;
+    char prefetch_paths[PREFETCH_RADIUS * 2][MAX_PATH_LENGTH];
+    int prefetch_count;
+    char (*thumbnail_paths)[MAX_PATH_LENGTH];
+    int *thumbnail_indices;
+    int thumbnail_next;
+    int thumbnail_count;
+    char active_path[MAX_PATH_LENGTH];
+    int active;
+    int quit;
+} ImageLoader;
+
+// Pixel formats the renderer accepts without converting on upload
+typedef struct {
+    Uint32 formats[16];
+    int count;
+} TextureFormatList;
+
+// Grid of GPU-sized textures covering one image, row-major
+typedef struct {
+    SDL_Texture **tiles;
+    int columns;
+    int rows;
+    int tile_width;
+    int tile_height;
+    int width;
+    int height;
+} TiledTexture;
+
+// Level 0 is full resolution; each further level halves both dimensions
+typedef struct {
+    TiledTexture levels[MAX_MIP_LEVELS];
+    int level_count;
+    int width;
+    int height;
+} ImagePyramid;
+
+// Main-thread textures showing a ProgressiveImage until its full decode lands
+typedef struct {
+    ProgressiveImage *source;
+    SDL_Texture *preview;
+    SDL_Texture *rows;
+    Uint32 rows_format;
+    int rows_visible;
+} StreamView;
+
+typedef struct {
+    char filepath[MAX_PATH_LENGTH];
+    ImagePyramid image;
+    ImageMetadata metadata;
+    Uint32 last_used;
+    size_t bytes; // Estimated from texture format x width x height over every level
+    int reduced;
+    int stale; // The file changed while this was on screen; never found again, dropped once replaced
+} TextureCacheEntry;
+
+typedef struct {
+    TextureCacheEntry entries[TEXTURE_CACHE_SIZE];
+    Uint32 clock;
+    size_t bytes;
+} TextureCache;
+
+typedef struct {
+    char directory[MAX_PATH_LENGTH];
+    char **files;
+    int count;
+    int capacity;
+    int current;
+    int gap; // While current is -1 because its file went away: that file's position plus one, else 0
+    int direction; // Sign of the last navigation step; 0 until the user moves
+} DirectoryIndex;
+
+// Change notifications for the indexed folder: inotify on Linux, ReadDirectoryChangesW on
+// Windows. Names are collected and applied once the folder has been quiet for WATCH_SETTLE_MS.
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+    OVERLAPPED overlapped;
+    DWORD *buffer;
+#else
+    int fd;
+#endif
+    int active;
+    int started; // Set once directory has been tried, so a failed watch is not retried every frame
+    char directory[MAX_PATH_LENGTH];
+    char (*pending)[MAX_FILENAME_LENGTH];
+    int pending_count;
+    int overflowed; // Notifications were lost; the listing is diffed against the index instead
+    Uint64 last_event;
+} DirectoryWatcher;
+
+// Overlay strings, formatted only when their inputs change
+typedef struct {
+    char metadata_lines[MAX_INFO_LINES][MAX_INFO_LINE_LENGTH];
+    int metadata_line_count;
+    char summary_lines[2][64];
+    int metadata_version;
+    float zoom;
+    int valid;
+} OverlayText;
+
+// Embedded font baked into one texture; text is queued and drawn in a single geometry batch.
+// SDL before 2.0.18 has no geometry API, so there each glyph is copied as it is queued.
+typedef struct {
+    SDL_Texture *texture;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_Vertex *vertices;
+    int *indices;
+#endif
+    int glyph_count;
+} GlyphAtlas;
+
+// Contact sheet of the current directory. Thumbnails live in fixed slots of a few atlas
+// textures; slots not drawn in the current frame are recycled first.
+typedef struct {
+    int active;
+    int scroll_y;
+    int selected;
+    Uint32 frame;
+    SDL_Texture *atlases[GRID_ATLAS_COUNT];
+    int atlas_count;
+    int slots_per_row;
+    int slots_per_atlas;
+    int slot_count;
+    int slot_files[GRID_MAX_SLOTS];
+    SDL_Rect slot_rects[GRID_MAX_SLOTS];
+    int slot_orientations[GRID_MAX_SLOTS];
+    Uint32 slot_frames[GRID_MAX_SLOTS];
+    int *file_slots;
+    Uint8 *file_failed;
+    int file_count;
+    char directory[MAX_PATH_LENGTH];
+    int requested_first;
+    int requested_last;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_Vertex *vertices;
+    int *indices;
+#endif
+} GridView;
+
+// Zoom and pan eased toward their targets on a fixed-timestep clock. Pan is relative to
+// the centred position, the anchor to the window centre.
+typedef struct {
+    int active;
+    float target_zoom;
+    float target_pan_x;
+    float target_pan_y;
+    float anchor_x; // Window point kept still while zooming
+    float anchor_y;
+    Uint64 last_counter;
+    double lag_ms;
+} ViewAnimation;
+
+// Incremental GIF decoder compositing one frame at a time onto a full-size canvas
+typedef struct {
+    const Uint8 *data;
+    size_t size;
+    size_t position;
+    size_t first_frame;
+    int width;
+    int height;
+    Uint32 global_palette[256];
+    int global_palette_size;
+    Uint32 *canvas;
+    Uint32 *previous; // Saved canvas for "restore to previous" disposal, allocated on first use
+    int dispose; // Disposal of the frame currently on the canvas
+    SDL_Rect dispose_rect;
+    int frame_index;
+    Uint16 prefix[4096];
+    Uint8 suffix[4096];
+    Uint8 stack[4097];
+} GifDecoder;
+
+typedef struct {
+    SDL_Surface *surface;
+    Uint32 delay_ms;
+    int index;
+} AnimationFrame;
+
+// Frames decoded ahead by a producer thread into a fixed ring, so memory stays bounded
+// however many frames the file holds
+typedef struct {
+    SDL_Thread *thread;
+    SDL_mutex *lock;
+    SDL_cond *changed;
+    MappedFile file;
+    GifDecoder gif;
+    AnimationFrame ring[ANIMATION_RING_FRAMES];
+    int ring_size;
+    int head; // Next frame to show
+    int filled; // Decoded frames waiting, starting at head
+    int quit;
+    int failed;
+} AnimationDecoder;
+
+// Main-thread playback. With atlas_columns set every frame gets its own cell of the
+// texture and the decoder is dropped after the first loop; otherwise the texture holds
+// the current frame only.
+typedef struct {
+    AnimationDecoder *decoder;
+    char filepath[MAX_PATH_LENGTH];
+    int width;
+    int height;
+    int frame_count;
+    SDL_Texture *texture;
+    int atlas_columns;
+    int atlas_loaded;
+    Uint32 *delays;
+    int frame;
+    int has_frame;
+    int frozen; // The decoder failed; frame stays on screen, from its atlas cell if there is one
+    Uint64 next_frame_at;
+} AnimationPlayer;
+
+// Timed walk through the directory. The next image is prefetched into the texture cache
+// while the current one is shown; a deadline is missed when it is still loading.
+typedef struct {
+    int active;
+    Uint32 interval_ms;
+    Uint32 crossfade_ms;
+    Uint64 next_deadline; // Zero until the first image is on screen
+    Uint64 missed_deadline; // Deadline of the image being waited on, zero when none
+    int shown;
+    int missed;
+    Uint64 total_late_ms;
+    Uint64 worst_late_ms;
+    SDL_Texture *fade_from; // Window-sized snapshots of the outgoing and incoming image
+    SDL_Texture *fade_to;
+    Uint64 fade_start;
+    int fading;
+} Slideshow;
+
+typedef struct {
+    SDL_Window *window;
+    SDL_Renderer *renderer;
+    ImagePyramid *image;
+    int max_texture_width;
+    int max_texture_height;
+    TextureFormatList texture_formats;
+    int window_width;
+    int window_height;
+    int image_width;
+    int image_height;
+    int running;
+    float zoom;
+    float pan_x;
+    float pan_y;
+    ViewAnimation animation;
+    int dragging; // 1 while the left button is held, 2 once it has moved far enough to pan
+    int drag_start_x;
+    int drag_start_y;
+    int fit_to_window;
+    int show_info;
+    int show_stats;
+    int benchmark; // Hidden window and software renderer, for headless runs
+    int needs_redraw;
+    int loading;
+    int image_orientation; // EXIF orientation of what is on screen, applied when drawing
+    int image_reduced; // What is on screen is a reduced decode of current_path
+    int upgrade_requested;
+    char current_path[MAX_PATH_LENGTH];
+    ImageLoader loader;
+    PixelPool pixel_pool;
+    MemoryBudget memory;
+    ColorManager color;
+    WorkerPool decode_workers;
+    ThumbnailCache thumbnails;
+    StreamView stream_view;
+    AnimationPlayer player;
+    TextureCache cache;
+    DirectoryIndex directory;
+    DirectoryWatcher watcher;
+    ImageMetadata metadata;
+    int metadata_version;
+    OverlayText overlay_text;
+    GlyphAtlas font;
+    GridView grid;
+    Slideshow slideshow;
+    FrameStats stats;
+} App;
+
 // Security functions
 SecurityResult validate_filepath(const char *filepath) {
     if (!filepath) {
@@ -130,13 +714,18 @@ void secure_strncpy(char *dest, const char *src, size_t dest_size) {
     dest[dest_size - 1] = '\0';
 }
 
+// Full-speed wipe the compiler cannot drop as a dead store
 void secure_memzero(void *ptr, size_t size) {
-    if (ptr && size > 0) {
-        volatile char *p = (volatile char *)ptr;
-        for (size_t i = 0; i < size; i++) {
-            p[i] = 0;
-        }
+    if (!ptr || size == 0) {
+        return;
     }
+
+#ifdef _WIN32
+    SecureZeroMemory(ptr, size);
+#else
+    static void *(*const volatile memset_volatile)(void *, int, size_t) = memset;
+    memset_volatile(ptr, 0, size);
+#endif
 }
 
 SecurityResult safe_malloc(void **ptr, size_t size) {
@@ -148,15 +737,45 @@ SecurityResult safe_malloc(void **ptr, size_t size) {
         return SECURITY_ERROR_MEMORY_ALLOCATION;
     }
 
+    // calloc hands large blocks back as fresh zero pages instead of touching every byte
+    *ptr = calloc(1, size);
+    if (!*ptr) {
+        return SECURITY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    return SECURITY_OK;
+}
+
+// For buffers the caller overwrites completely, e.g. decoded pixels
+SecurityResult safe_malloc_uninitialized(void **ptr, size_t size) {
+    if (!ptr) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    if (size == 0 || size > SIZE_MAX / 2) {
+        return SECURITY_ERROR_MEMORY_ALLOCATION;
+    }
+
     *ptr = malloc(size);
     if (!*ptr) {
         return SECURITY_ERROR_MEMORY_ALLOCATION;
     }
 
-    memset(*ptr, 0, size);
     return SECURITY_OK;
 }
 
+SecurityResult safe_calloc(void **ptr, size_t count, size_t size) {
+    if (!ptr) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    if (count == 0 || size == 0 || count > SIZE_MAX / 2 / size) {
+        return SECURITY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    return safe_malloc(ptr, count * size);
+}
+
 void safe_free(void **ptr) {
     if (ptr && *ptr) {
         secure_memzero(*ptr, 0);
@@ -224,375 +843,7296 @@ char* format_file_size(long bytes) {
     return buffer;
 }
 
-// Image loading functions
-SecurityResult load_image_secure(App *app, const char *image_path) {
-    if (!app || !image_path) {
-        return SECURITY_ERROR_INVALID_INPUT;
-    }
+// Byte order helpers for parsing file headers
+static Uint16 read_be16(const Uint8 *p) {
+    return (Uint16)((p[0] << 8) | p[1]);
+}
 
-    SecurityResult result = validate_filepath(image_path);
-    if (result != SECURITY_OK) {
-        return result;
-    }
+static Uint32 read_be32(const Uint8 *p) {
+    return ((Uint32)p[0] << 24) | ((Uint32)p[1] << 16) | ((Uint32)p[2] << 8) | (Uint32)p[3];
+}
 
-    struct stat file_stat;
-    if (stat(image_path, &file_stat) != 0) {
-        return SECURITY_ERROR_ACCESS_DENIED;
-    }
+static Uint16 read_le16(const Uint8 *p) {
+    return (Uint16)(p[0] | (p[1] << 8));
+}
 
-    result = validate_image_size(file_stat.st_size);
-    if (result != SECURITY_OK) {
-        return result;
-    }
+static Uint32 read_le32(const Uint8 *p) {
+    return (Uint32)p[0] | ((Uint32)p[1] << 8) | ((Uint32)p[2] << 16) | ((Uint32)p[3] << 24);
+}
 
-    SDL_Surface *surface = IMG_Load(image_path);
-    if (!surface) {
-        return SECURITY_ERROR_ACCESS_DENIED;
-    }
+static Sint64 read_le64(const Uint8 *p) {
+    return (Sint64)((Uint64)read_le32(p) | ((Uint64)read_le32(p + 4) << 32));
+}
 
-    if (surface->w <= 0 || surface->h <= 0 || surface->w > 32768 || surface->h > 32768) {
-        SDL_FreeSurface(surface);
-        return SECURITY_ERROR_INVALID_INPUT;
-    }
+static void write_le16(Uint8 *p, Uint16 value) {
+    p[0] = (Uint8)value;
+    p[1] = (Uint8)(value >> 8);
+}
 
-    if (app->image_texture) {
-        SDL_DestroyTexture(app->image_texture);
-        app->image_texture = NULL;
-    }
+static void write_le32(Uint8 *p, Uint32 value) {
+    write_le16(p, (Uint16)value);
+    write_le16(p + 2, (Uint16)(value >> 16));
+}
 
-    app->image_texture = SDL_CreateTextureFromSurface(app->renderer, surface);
-    if (!app->image_texture) {
-        SDL_FreeSurface(surface);
-        return SECURITY_ERROR_MEMORY_ALLOCATION;
-    }
+static void write_le64(Uint8 *p, Sint64 value) {
+    write_le32(p, (Uint32)(Uint64)value);
+    write_le32(p + 4, (Uint32)((Uint64)value >> 32));
+}
 
-    app->image_width = surface->w;
-    app->image_height = surface->h;
-    SDL_FreeSurface(surface);
+// Stats functions
+static const char *const stats_stage_names[STATS_STAGE_COUNT] = {
+    "open", "metadata", "decode", "convert", "upload", "render", "present"
+};
 
-    return SECURITY_OK;
+double stats_elapsed_ms(Uint64 start) {
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
 }
 
-int load_image(App *app, const char *image_path) {
-    SecurityResult result = load_image_secure(app, image_path);
-    
-    switch (result) {
-        case SECURITY_OK:
-            SDL_Log("Loaded image: %s (%dx%d)", image_path, app->image_width, app->image_height);
-            return 1;
-        case SECURITY_ERROR_INVALID_INPUT:
-            SDL_Log("Security error: Invalid input parameters");
-            return 0;
-        case SECURITY_ERROR_PATH_TOO_LONG:
-            SDL_Log("Security error: File path too long");
-            return 0;
-        case SECURITY_ERROR_FILE_TOO_LARGE:
-            SDL_Log("Security error: File size exceeds limit");
-            return 0;
-        case SECURITY_ERROR_ACCESS_DENIED:
-            SDL_Log("Security error: Access denied or file not found");
-            return 0;
-        case SECURITY_ERROR_MEMORY_ALLOCATION:
-            SDL_Log("Security error: Memory allocation failed");
-            return 0;
-        default:
-            SDL_Log("Security error: Unknown error occurred");
-            return 0;
+void stats_record(FrameStats *stats, StatsStage stage, double ms) {
+    if (!stats || stage < 0 || stage >= STATS_STAGE_COUNT) {
+        return;
+    }
+
+    stats->samples[stage][stats->next[stage]] = (float)ms;
+    stats->next[stage] = (stats->next[stage] + 1) % STATS_WINDOW;
+    stats->count[stage]++;
+    stats->total_ms[stage] += ms;
+    if (ms > stats->max_ms[stage]) {
+        stats->max_ms[stage] = ms;
     }
 }
 
-// Metadata functions
-int extract_metadata(const char *filepath, ImageMetadata *metadata) {
-    if (!filepath || !metadata) {
+static int compare_floats(const void *a, const void *b) {
+    float x = *(const float *)a;
+    float y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an ascending array
+static double percentile_sorted(const float *sorted, long count, int percent) {
+    long rank = (count * percent + 99) / 100;
+    return sorted[SDL_max(rank, 1L) - 1];
+}
+
+// Nearest-rank percentiles over the window; mean and max cover the whole session
+int stats_summarize(const FrameStats *stats, StatsStage stage, StatsSummary *out) {
+    if (!stats || !out || stage < 0 || stage >= STATS_STAGE_COUNT) {
         return 0;
     }
 
-    SecurityResult sec_result = validate_filepath(filepath);
-    if (sec_result != SECURITY_OK) {
+    secure_memzero(out, sizeof(StatsSummary));
+    long window = SDL_min(stats->count[stage], (long)STATS_WINDOW);
+    if (window == 0) {
         return 0;
     }
 
-    secure_strncpy(metadata->filepath, filepath, sizeof(metadata->filepath));
+    float sorted[STATS_WINDOW];
+    memcpy(sorted, stats->samples[stage], (size_t)window * sizeof(float));
+    qsort(sorted, (size_t)window, sizeof(float), compare_floats);
 
-    const char *filename = strrchr(filepath, '/');
-    if (!filename) {
-        filename = strrchr(filepath, '\\');
-    }
-    if (filename) {
-        filename++;
-    } else {
-        filename = filepath;
-    }
-    
-    secure_strncpy(metadata->filename, filename, sizeof(metadata->filename));
-    sec_result = sanitize_filename(metadata->filename, sizeof(metadata->filename));
-    if (sec_result != SECURITY_OK) {
+    out->count = stats->count[stage];
+    out->mean_ms = stats->total_ms[stage] / (double)stats->count[stage];
+    out->p50_ms = percentile_sorted(sorted, window, 50);
+    out->p99_ms = percentile_sorted(sorted, window, 99);
+    out->max_ms = stats->max_ms[stage];
+    return 1;
+}
+
+// One row per stage, tagged with the SDL version and renderer so runs can be compared
+int stats_write_csv(const FrameStats *stats, const char *renderer_name) {
+    if (!stats || !stats->csv_path[0]) {
         return 0;
     }
 
-    secure_strncpy(metadata->format, get_format_name(filepath), sizeof(metadata->format));
+    FILE *file = fopen(stats->csv_path, "w");
+    if (!file) {
+        SDL_Log("Failed to write stats to %s", stats->csv_path);
+        return 0;
+    }
 
-    struct stat file_stat;
-    if (stat(filepath, &file_stat) == 0) {
-        sec_result = validate_image_size(file_stat.st_size);
-        if (sec_result != SECURITY_OK) {
-            return 0;
-        }
-        
-        metadata->file_size = file_stat.st_size;
-        metadata->creation_time = file_stat.st_ctime;
-        metadata->modification_time = file_stat.st_mtime;
-    } else {
-        metadata->file_size = 0;
-        metadata->creation_time = 0;
-        metadata->modification_time = 0;
+    SDL_version version;
+    SDL_GetVersion(&version);
+    fprintf(file, "sdl_version,renderer,stage,count,mean_ms,p50_ms,p99_ms,max_ms\n");
+    for (int stage = 0; stage < STATS_STAGE_COUNT; stage++) {
+        StatsSummary summary;
+        stats_summarize(stats, (StatsStage)stage, &summary);
+        fprintf(file, "%d.%d.%d,%s,%s,%ld,%.3f,%.3f,%.3f,%.3f\n", version.major, version.minor, version.patch,
+                renderer_name ? renderer_name : "unknown", stats_stage_names[stage], summary.count,
+                summary.mean_ms, summary.p50_ms, summary.p99_ms, summary.max_ms);
     }
 
-    SDL_Surface *surface = IMG_Load(filepath);
-    if (surface) {
-        metadata->width = surface->w;
-        metadata->height = surface->h;
-        metadata->bits_per_pixel = surface->format->BitsPerPixel;
-        SDL_FreeSurface(surface);
-    } else {
-        metadata->width = 0;
-        metadata->height = 0;
-        metadata->bits_per_pixel = 0;
+    int ok = fclose(file) == 0;
+    if (ok) {
+        SDL_Log("Stats written to %s", stats->csv_path);
     }
+    return ok;
+}
 
-    return 1;
+// File mapping functions
+#ifdef _WIN32
+static time_t filetime_to_time_t(const FILETIME *filetime) {
+    ULARGE_INTEGER ticks;
+    ticks.LowPart = filetime->dwLowDateTime;
+    ticks.HighPart = filetime->dwHighDateTime;
+    // 100ns intervals since 1601-01-01 to seconds since 1970-01-01
+    return (time_t)((ticks.QuadPart - 116444736000000000ULL) / 10000000ULL);
 }
+#endif
 
-void render_metadata_overlay(App *app, const ImageMetadata *metadata) {
-    if (!app || !metadata || !app->show_info) {
-        return;
+// Opens and maps the file once; the size limit is checked before anything is read
+SecurityResult map_file(const char *filepath, MappedFile *file) {
+    if (!filepath || !file) {
+        return SECURITY_ERROR_INVALID_INPUT;
     }
 
+    secure_memzero(file, sizeof(MappedFile));
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE) {
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    LARGE_INTEGER size;
+    FILETIME created;
+    FILETIME modified;
+    if (!GetFileSizeEx(handle, &size) || !GetFileTime(handle, &created, NULL, &modified)) {
+        CloseHandle(handle);
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    // Checked here rather than through validate_image_size because long is 32-bit on Windows
+    if (size.QuadPart <= 0 || size.QuadPart > MAX_FILE_SIZE) {
+        CloseHandle(handle);
+        return size.QuadPart <= 0 ? SECURITY_ERROR_INVALID_INPUT : SECURITY_ERROR_FILE_TOO_LARGE;
+    }
+
+    file->mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(handle);
+    if (!file->mapping) {
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    file->data = (const Uint8 *)MapViewOfFile(file->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!file->data) {
+        CloseHandle(file->mapping);
+        file->mapping = NULL;
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    file->size = (size_t)size.QuadPart;
+    file->creation_time = filetime_to_time_t(&created);
+    file->modification_time = filetime_to_time_t(&modified);
+#else
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) {
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+        close(fd);
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    SecurityResult result = validate_image_size(file_stat.st_size);
+    if (result != SECURITY_OK || file_stat.st_size == 0) {
+        close(fd);
+        return result != SECURITY_OK ? result : SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    void *data = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    // Decoders read front to back
+    posix_madvise(data, (size_t)file_stat.st_size, POSIX_MADV_SEQUENTIAL);
+
+    file->data = (const Uint8 *)data;
+    file->size = (size_t)file_stat.st_size;
+    file->creation_time = file_stat.st_ctime;
+    file->modification_time = file_stat.st_mtime;
+#endif
+
+    return SECURITY_OK;
+}
+
+void unmap_file(MappedFile *file) {
+    if (!file || !file->data) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile((LPCVOID)file->data);
+    CloseHandle(file->mapping);
+#else
+    munmap((void *)file->data, file->size);
+#endif
+    secure_memzero(file, sizeof(MappedFile));
+}
+
+// Pixel buffer pool functions
+int pixel_pool_init(PixelPool *pool, size_t max_idle_bytes) {
+    secure_memzero(pool, sizeof(PixelPool));
+    pool->lock = SDL_CreateMutex();
+    if (!pool->lock) {
+        SDL_Log("Failed to create pixel pool lock: %s", SDL_GetError());
+        return 0;
+    }
+    pool->max_idle_bytes = max_idle_bytes;
+    return 1;
+}
+
+// Frees idle buffers only; buffers still backing surfaces must be released first
+void pixel_pool_destroy(PixelPool *pool) {
+    if (!pool || !pool->lock) {
+        return;
+    }
+
+    for (int i = 0; i < PIXEL_POOL_BUCKETS; i++) {
+        while (pool->free_lists[i]) {
+            PixelBuffer *buffer = pool->free_lists[i];
+            pool->free_lists[i] = buffer->next;
+            free(buffer);
+        }
+    }
+    SDL_DestroyMutex(pool->lock);
+    secure_memzero(pool, sizeof(PixelPool));
+}
+
+// Buckets step through 1, 1.25, 1.5 and 1.75 times each power of two
+static size_t pixel_pool_bucket_size(int bucket) {
+    int octave = bucket / PIXEL_POOL_STEPS;
+    int step = bucket % PIXEL_POOL_STEPS;
+    return ((size_t)1 << (octave + PIXEL_POOL_MIN_SHIFT - 2)) * (size_t)(PIXEL_POOL_STEPS + step);
+}
+
+static int pixel_pool_bucket(size_t size) {
+    for (int i = 0; i < PIXEL_POOL_BUCKETS; i++) {
+        if (size <= pixel_pool_bucket_size(i)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Reuses an idle buffer of the same bucket if there is one; contents are not cleared
+static PixelBuffer *pixel_pool_acquire(PixelPool *pool, size_t size) {
+    int bucket = pixel_pool_bucket(size);
+    PixelBuffer *buffer = NULL;
+
+    if (bucket >= 0) {
+        SDL_LockMutex(pool->lock);
+        buffer = pool->free_lists[bucket];
+        if (buffer) {
+            pool->free_lists[bucket] = buffer->next;
+            pool->idle_bytes -= buffer->capacity;
+        }
+        SDL_UnlockMutex(pool->lock);
+        if (buffer) {
+            buffer->next = NULL;
+            return buffer;
+        }
+    }
+
+    // Oversized requests bypass the buckets and are freed on release
+    size_t capacity = bucket >= 0 ? pixel_pool_bucket_size(bucket) : size;
+    if (capacity > SIZE_MAX / 2 - PIXEL_BUFFER_HEADER ||
+        safe_malloc_uninitialized((void **)&buffer, capacity + PIXEL_BUFFER_HEADER) != SECURITY_OK) {
+        return NULL;
+    }
+    buffer->pool = pool;
+    buffer->next = NULL;
+    buffer->capacity = capacity;
+    buffer->bucket = bucket;
+    return buffer;
+}
+
+static void pixel_pool_release(PixelBuffer *buffer) {
+    PixelPool *pool = buffer->pool;
+    int keep = 0;
+
+    SDL_LockMutex(pool->lock);
+    if (buffer->bucket >= 0 && pool->idle_bytes + buffer->capacity <= pool->max_idle_bytes) {
+        buffer->next = pool->free_lists[buffer->bucket];
+        pool->free_lists[buffer->bucket] = buffer;
+        pool->idle_bytes += buffer->capacity;
+        keep = 1;
+    }
+    SDL_UnlockMutex(pool->lock);
+
+    if (!keep) {
+        free(buffer);
+    }
+}
+
+// Surface whose pixels come from the pool; must be freed with release_surface
+SDL_Surface *pixel_pool_create_surface(PixelPool *pool, int width, int height, int depth, Uint32 format) {
+    if (!pool || !pool->lock) {
+        return SDL_CreateRGBSurfaceWithFormat(0, width, height, depth, format);
+    }
+    if (width <= 0 || height <= 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION) {
+        return NULL;
+    }
+
+    int pitch = (width * (depth / 8) + 3) & ~3;
+    PixelBuffer *buffer = pixel_pool_acquire(pool, (size_t)pitch * (size_t)height);
+    if (!buffer) {
+        return NULL;
+    }
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormatFrom((Uint8 *)buffer + PIXEL_BUFFER_HEADER, width,
+                                                              height, depth, pitch, format);
+    if (!surface) {
+        pixel_pool_release(buffer);
+        return NULL;
+    }
+    surface->userdata = buffer;
+    return surface;
+}
+
+// Frees any surface, returning pool-backed pixels to their pool
+void release_surface(SDL_Surface *surface) {
+    if (!surface) {
+        return;
+    }
+
+    PixelBuffer *buffer = (PixelBuffer *)surface->userdata;
+    SDL_FreeSurface(surface);
+    if (buffer) {
+        pixel_pool_release(buffer);
+    }
+}
+
+size_t pixel_pool_idle(PixelPool *pool) {
+    if (!pool || !pool->lock) {
+        return 0;
+    }
+
+    SDL_LockMutex(pool->lock);
+    size_t idle = pool->idle_bytes;
+    SDL_UnlockMutex(pool->lock);
+    return idle;
+}
+
+// Hands every idle buffer back to the OS, e.g. to make room under the CPU budget
+void pixel_pool_trim(PixelPool *pool) {
+    if (!pool || !pool->lock) {
+        return;
+    }
+
+    PixelBuffer *released = NULL;
+    SDL_LockMutex(pool->lock);
+    for (int i = 0; i < PIXEL_POOL_BUCKETS; i++) {
+        while (pool->free_lists[i]) {
+            PixelBuffer *buffer = pool->free_lists[i];
+            pool->free_lists[i] = buffer->next;
+            buffer->next = released;
+            released = buffer;
+        }
+    }
+    pool->idle_bytes = 0;
+    SDL_UnlockMutex(pool->lock);
+
+    while (released) {
+        PixelBuffer *buffer = released;
+        released = buffer->next;
+        free(buffer);
+    }
+}
+
+// Memory budget functions
+// Computed in 64 bits and clamped, as caps of 4 GiB and up do not fit a 32-bit size_t
+size_t memory_budget_bytes(size_t mb) {
+    Uint64 bytes = (Uint64)mb * 1024 * 1024;
+    return bytes >= (Uint64)(SIZE_MAX / 2) ? SIZE_MAX / 2 : (size_t)bytes;
+}
+
+void memory_budget_init(MemoryBudget *budget, size_t cpu_cap_mb, size_t gpu_cap_mb) {
+    secure_memzero(budget, sizeof(MemoryBudget));
+    budget->cpu_cap = memory_budget_bytes(cpu_cap_mb);
+    budget->gpu_cap = memory_budget_bytes(gpu_cap_mb);
+}
+
+void memory_budget_charge(MemoryBudget *budget, size_t bytes) {
+    if (budget && bytes > 0) {
+        SDL_AtomicAdd(&budget->cpu_kib, (int)((bytes + 1023) / 1024));
+    }
+}
+
+void memory_budget_refund(MemoryBudget *budget, size_t bytes) {
+    if (budget && bytes > 0) {
+        SDL_AtomicAdd(&budget->cpu_kib, -(int)((bytes + 1023) / 1024));
+    }
+}
+
+size_t memory_budget_cpu_bytes(MemoryBudget *budget) {
+    return budget ? (size_t)SDL_max(SDL_AtomicGet(&budget->cpu_kib), 0) * 1024 : 0;
+}
+
+static size_t surface_bytes(const SDL_Surface *surface) {
+    return surface ? (size_t)surface->pitch * (size_t)surface->h : 0;
+}
+
+// Bytes of an image decoded at 1/factor scale, as 32-bit pixels with its mip chain
+static Uint64 memory_budget_estimate(const ImageMetadata *metadata, int factor) {
+    Uint64 width = (Uint64)(metadata->width + factor - 1) / (Uint64)factor;
+    Uint64 height = (Uint64)(metadata->height + factor - 1) / (Uint64)factor;
+    return width * height * 4 * 4 / 3;
+}
+
+// What is left of the CPU cap; idle pool buffers count as used until they are trimmed
+static Uint64 memory_budget_cpu_available(MemoryBudget *budget, PixelPool *pool) {
+    Uint64 in_use = (Uint64)memory_budget_cpu_bytes(budget) + pixel_pool_idle(pool);
+    return in_use < budget->cpu_cap ? budget->cpu_cap - in_use : 0;
+}
+
+// Whether the decoded image fits in what is left of both caps; images with no header
+// size are let through
+int memory_budget_allows(MemoryBudget *budget, PixelPool *pool, const ImageMetadata *metadata) {
+    if (!budget || metadata->width <= 0 || metadata->height <= 0) {
+        return 1;
+    }
+
+    Uint64 estimate = memory_budget_estimate(metadata, 1);
+    return estimate <= budget->gpu_cap && estimate <= memory_budget_cpu_available(budget, pool);
+}
+
+// Smallest power-of-two reduction that brings the image within what is left of the CPU cap;
+// 0 when even the largest reduced decode would not fit
+int memory_budget_reduction(MemoryBudget *budget, PixelPool *pool, const ImageMetadata *metadata) {
+    Uint64 available = memory_budget_cpu_available(budget, pool);
+    for (int factor = 2; factor <= DECODE_MAX_REDUCTION; factor *= 2) {
+        if (memory_budget_estimate(metadata, factor) <= available) {
+            return factor;
+        }
+    }
+    return 0;
+}
+
+// Leading levels that must be dropped for the rest of the pyramid to fit in cap bytes;
+// the smallest level is always kept
+int memory_budget_levels_over(SDL_Surface **levels, int level_count, size_t cap) {
+    size_t total = 0;
+    for (int i = 0; i < level_count; i++) {
+        total += surface_bytes(levels[i]);
+    }
+
+    int skip = 0;
+    while (skip + 1 < level_count && total > cap) {
+        total -= surface_bytes(levels[skip]);
+        skip++;
+    }
+    return skip;
+}
+
+// Worker pool functions
+static int worker_pool_thread(void *data) {
+    WorkerPool *pool = (WorkerPool *)data;
+
+    SDL_LockMutex(pool->lock);
+    while (!pool->quit) {
+        if (pool->next_index >= pool->task_count) {
+            SDL_CondWait(pool->wake, pool->lock);
+            continue;
+        }
+
+        int index = pool->next_index++;
+        SDL_UnlockMutex(pool->lock);
+        pool->task(pool->context, index);
+        SDL_LockMutex(pool->lock);
+
+        if (--pool->remaining == 0) {
+            SDL_CondSignal(pool->done);
+        }
+    }
+    SDL_UnlockMutex(pool->lock);
+
+    return 0;
+}
+
+// Starts up to thread_count helpers; a pool that got none still runs tasks on the caller
+int worker_pool_start(WorkerPool *pool, int thread_count) {
+    secure_memzero(pool, sizeof(WorkerPool));
+    pool->lock = SDL_CreateMutex();
+    pool->wake = SDL_CreateCond();
+    pool->done = SDL_CreateCond();
+    if (!pool->lock || !pool->wake || !pool->done) {
+        SDL_Log("Failed to create worker synchronization: %s", SDL_GetError());
+        return 0;
+    }
+
+    thread_count = SDL_max(0, SDL_min(thread_count, MAX_WORKER_THREADS));
+    for (int i = 0; i < thread_count; i++) {
+        pool->threads[i] = SDL_CreateThread(worker_pool_thread, "photon-worker", pool);
+        if (!pool->threads[i]) {
+            SDL_Log("Failed to create worker thread: %s", SDL_GetError());
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    return 1;
+}
+
+void worker_pool_stop(WorkerPool *pool) {
+    if (!pool || !pool->lock) {
+        return;
+    }
+
+    SDL_LockMutex(pool->lock);
+    pool->quit = 1;
+    SDL_CondBroadcast(pool->wake);
+    SDL_UnlockMutex(pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        SDL_WaitThread(pool->threads[i], NULL);
+    }
+
+    SDL_DestroyCond(pool->done);
+    SDL_DestroyCond(pool->wake);
+    SDL_DestroyMutex(pool->lock);
+    secure_memzero(pool, sizeof(WorkerPool));
+}
+
+// Blocks until every index has run; one caller at a time
+void worker_pool_run(WorkerPool *pool, WorkerTask task, void *context, int count) {
+    if (!pool || !pool->lock) {
+        for (int i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+
+    SDL_LockMutex(pool->lock);
+    pool->task = task;
+    pool->context = context;
+    pool->next_index = 0;
+    pool->task_count = count;
+    pool->remaining = count;
+    SDL_CondBroadcast(pool->wake);
+
+    while (pool->next_index < pool->task_count) {
+        int index = pool->next_index++;
+        SDL_UnlockMutex(pool->lock);
+        task(context, index);
+        SDL_LockMutex(pool->lock);
+        pool->remaining--;
+    }
+    while (pool->remaining > 0) {
+        SDL_CondWait(pool->done, pool->lock);
+    }
+
+    pool->task = NULL;
+    pool->context = NULL;
+    pool->task_count = 0;
+    pool->next_index = 0;
+    SDL_UnlockMutex(pool->lock);
+}
+
+// Pixel conversion functions
+// Row kernels for the byte layouts decoders actually produce. Names describe memory order:
+// expand copies 3 bytes and appends 0xFF, the swap variants exchange bytes 0 and 2.
+typedef void (*RowConverter)(const Uint8 *src, Uint8 *dst, int width);
+
+static void expand_24_keep_scalar(const Uint8 *src, Uint8 *dst, int width) {
+    for (int x = 0; x < width; x++, src += 3, dst += 4) {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = 0xFF;
+    }
+}
+
+static void expand_24_swap_scalar(const Uint8 *src, Uint8 *dst, int width) {
+    for (int x = 0; x < width; x++, src += 3, dst += 4) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        dst[3] = 0xFF;
+    }
+}
+
+static void swap_32_scalar(const Uint8 *src, Uint8 *dst, int width) {
+    for (int x = 0; x < width; x++, src += 4, dst += 4) {
+        Uint8 first = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = first;
+        dst[3] = src[3];
+    }
+}
+
+#ifdef PHOTON_X86_KERNELS
+// pshufb is SSSE3; SDL only reports SSE4.1, which implies it
+__attribute__((target("ssse3"))) static void expand_24_shuffle_ssse3(const Uint8 *src, Uint8 *dst, int width,
+                                                                       __m128i shuffle, RowConverter tail) {
+    const __m128i alpha = _mm_set1_epi32((int)0xFF000000u);
+    int x = 0;
+    // Each step reads 16 bytes for 4 pixels, so stop while 6 pixels of input remain
+    for (; x + 6 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x * 3));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    if (x < width) {
+        tail(src + x * 3, dst + x * 4, width - x);
+    }
+}
+
+__attribute__((target("ssse3"))) static void expand_24_keep_ssse3(const Uint8 *src, Uint8 *dst, int width) {
+    expand_24_shuffle_ssse3(src, dst, width,
+                            _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                            expand_24_keep_scalar);
+}
+
+__attribute__((target("ssse3"))) static void expand_24_swap_ssse3(const Uint8 *src, Uint8 *dst, int width) {
+    expand_24_shuffle_ssse3(src, dst, width,
+                            _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1),
+                            expand_24_swap_scalar);
+}
+
+__attribute__((target("avx2"))) static void expand_24_shuffle_avx2(const Uint8 *src, Uint8 *dst, int width,
+                                                                     __m256i shuffle, RowConverter tail) {
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000u);
+    int x = 0;
+    // Two 4-pixel groups per lane; the upper load ends 28 bytes in, so keep 10 pixels of input
+    for (; x + 10 <= width; x += 8) {
+        const Uint8 *in = src + x * 3;
+        __m256i pixels = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+            _mm_loadu_si128((const __m128i *)(in + 12)), 1);
+        _mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    if (x < width) {
+        tail(src + x * 3, dst + x * 4, width - x);
+    }
+}
+
+__attribute__((target("avx2"))) static void expand_24_keep_avx2(const Uint8 *src, Uint8 *dst, int width) {
+    expand_24_shuffle_avx2(src, dst, width,
+                           _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1),
+                           expand_24_keep_scalar);
+}
+
+__attribute__((target("avx2"))) static void expand_24_swap_avx2(const Uint8 *src, Uint8 *dst, int width) {
+    expand_24_shuffle_avx2(src, dst, width,
+                           _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+                                            2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1),
+                           expand_24_swap_scalar);
+}
+
+__attribute__((target("sse2"))) static void swap_32_sse2(const Uint8 *src, Uint8 *dst, int width) {
+    const __m128i keep = _mm_set1_epi32((int)0xFF00FF00u);
+    const __m128i move = _mm_set1_epi32(0x00FF00FF);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128((const __m128i *)(src + x * 4));
+        __m128i red_blue = _mm_and_si128(pixels, move);
+        red_blue = _mm_or_si128(_mm_slli_epi32(red_blue, 16), _mm_srli_epi32(red_blue, 16));
+        _mm_storeu_si128((__m128i *)(dst + x * 4), _mm_or_si128(_mm_and_si128(pixels, keep), red_blue));
+    }
+    swap_32_scalar(src + x * 4, dst + x * 4, width - x);
+}
+
+__attribute__((target("avx2"))) static void swap_32_avx2(const Uint8 *src, Uint8 *dst, int width) {
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                             2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pixels = _mm256_loadu_si256((const __m256i *)(src + x * 4));
+        _mm256_storeu_si256((__m256i *)(dst + x * 4), _mm256_shuffle_epi8(pixels, shuffle));
+    }
+    swap_32_scalar(src + x * 4, dst + x * 4, width - x);
+}
+#endif
+
+#ifdef PHOTON_NEON_KERNELS
+static void expand_24_keep_neon(const Uint8 *src, Uint8 *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x3_t in = vld3q_u8(src + x * 3);
+        uint8x16x4_t out = {{in.val[0], in.val[1], in.val[2], vdupq_n_u8(0xFF)}};
+        vst4q_u8(dst + x * 4, out);
+    }
+    expand_24_keep_scalar(src + x * 3, dst + x * 4, width - x);
+}
+
+static void expand_24_swap_neon(const Uint8 *src, Uint8 *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x3_t in = vld3q_u8(src + x * 3);
+        uint8x16x4_t out = {{in.val[2], in.val[1], in.val[0], vdupq_n_u8(0xFF)}};
+        vst4q_u8(dst + x * 4, out);
+    }
+    expand_24_swap_scalar(src + x * 3, dst + x * 4, width - x);
+}
+
+static void swap_32_neon(const Uint8 *src, Uint8 *dst, int width) {
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t in = vld4q_u8(src + x * 4);
+        uint8x16x4_t out = {{in.val[2], in.val[1], in.val[0], in.val[3]}};
+        vst4q_u8(dst + x * 4, out);
+    }
+    swap_32_scalar(src + x * 4, dst + x * 4, width - x);
+}
+#endif
+
+enum { KERNEL_EXPAND_KEEP, KERNEL_EXPAND_SWAP, KERNEL_SWAP_32 };
+
+// Widest implementation the running CPU supports; SDL caches the feature checks
+static RowConverter select_row_kernel(int kernel) {
+#ifdef PHOTON_X86_KERNELS
+    if (SDL_HasAVX2()) {
+        return kernel == KERNEL_EXPAND_KEEP ? expand_24_keep_avx2
+             : kernel == KERNEL_EXPAND_SWAP ? expand_24_swap_avx2 : swap_32_avx2;
+    }
+    if (SDL_HasSSE41() && kernel != KERNEL_SWAP_32) {
+        return kernel == KERNEL_EXPAND_KEEP ? expand_24_keep_ssse3 : expand_24_swap_ssse3;
+    }
+    if (SDL_HasSSE2() && kernel == KERNEL_SWAP_32) {
+        return swap_32_sse2;
+    }
+#endif
+#ifdef PHOTON_NEON_KERNELS
+    return kernel == KERNEL_EXPAND_KEEP ? expand_24_keep_neon
+         : kernel == KERNEL_EXPAND_SWAP ? expand_24_swap_neon : swap_32_neon;
+#else
+    return kernel == KERNEL_EXPAND_KEEP ? expand_24_keep_scalar
+         : kernel == KERNEL_EXPAND_SWAP ? expand_24_swap_scalar : swap_32_scalar;
+#endif
+}
+
+// Kernel for a format pair, or NULL when SDL's generic converter has to handle it
+static RowConverter choose_row_converter(Uint32 src_format, Uint32 dst_format) {
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+    int dst_bgra = dst_format == SDL_PIXELFORMAT_ARGB8888 || dst_format == SDL_PIXELFORMAT_RGB888;
+    int dst_rgba = dst_format == SDL_PIXELFORMAT_ABGR8888 || dst_format == SDL_PIXELFORMAT_BGR888;
+
+    if (src_format == SDL_PIXELFORMAT_RGB24 && (dst_bgra || dst_rgba)) {
+        return select_row_kernel(dst_bgra ? KERNEL_EXPAND_SWAP : KERNEL_EXPAND_KEEP);
+    }
+    if (src_format == SDL_PIXELFORMAT_BGR24 && (dst_bgra || dst_rgba)) {
+        return select_row_kernel(dst_rgba ? KERNEL_EXPAND_SWAP : KERNEL_EXPAND_KEEP);
+    }
+    // The padding byte of RGB888/BGR888 is undefined, so it may only become padding again
+    if ((src_format == SDL_PIXELFORMAT_ARGB8888 && dst_rgba) ||
+        (src_format == SDL_PIXELFORMAT_ABGR8888 && dst_bgra) ||
+        (src_format == SDL_PIXELFORMAT_RGB888 && dst_format == SDL_PIXELFORMAT_BGR888) ||
+        (src_format == SDL_PIXELFORMAT_BGR888 && dst_format == SDL_PIXELFORMAT_RGB888)) {
+        return select_row_kernel(KERNEL_SWAP_32);
+    }
+#else
+    (void)src_format;
+    (void)dst_format;
+#endif
+    return NULL;
+}
+
+// Drop-in for SDL_ConvertPixels that runs the vector kernels on the common decoder layouts
+int convert_pixels(int width, int height, Uint32 src_format, const void *src, int src_pitch,
+                   Uint32 dst_format, void *dst, int dst_pitch) {
+    RowConverter converter = choose_row_converter(src_format, dst_format);
+    if (!converter) {
+        return SDL_ConvertPixels(width, height, src_format, src, src_pitch, dst_format, dst, dst_pitch);
+    }
+
+    for (int y = 0; y < height; y++) {
+        converter((const Uint8 *)src + (size_t)y * src_pitch, (Uint8 *)dst + (size_t)y * dst_pitch, width);
+    }
+    return 0;
+}
+
+// Converted copy in the requested format, pool-backed when a kernel covers the layout.
+// The kernels copy pixels as they are, so colour-keyed sources go through SDL to turn the key transparent.
+SDL_Surface *convert_surface_format(PixelPool *pool, SDL_Surface *surface, Uint32 format) {
+    Uint32 color_key;
+    if (SDL_MUSTLOCK(surface) || SDL_GetColorKey(surface, &color_key) == 0 ||
+        !choose_row_converter(surface->format->format, format)) {
+        return SDL_ConvertSurfaceFormat(surface, format, 0);
+    }
+
+    SDL_Surface *converted = pixel_pool_create_surface(pool, surface->w, surface->h, 32, format);
+    if (!converted) {
+        return NULL;
+    }
+    convert_pixels(surface->w, surface->h, surface->format->format, surface->pixels, surface->pitch,
+                   format, converted->pixels, converted->pitch);
+    return converted;
+}
+
+// Result ring functions
+static int result_ring_try_push(ResultRing *ring, LoaderEventCode code, void *data) {
+    unsigned int head = (unsigned int)SDL_AtomicGet(&ring->head);
+    if (head - (unsigned int)SDL_AtomicGet(&ring->tail) >= RESULT_RING_SLOTS) {
+        return 0;
+    }
+
+    // Pairs with the release in result_ring_pop: the consumer is done with the slot being reused
+    SDL_MemoryBarrierAcquire();
+    ResultSlot *slot = &ring->slots[head & (RESULT_RING_SLOTS - 1)];
+    slot->code = code;
+    slot->data = data;
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&ring->head, (int)(head + 1));
+
+    // The main loop may be asleep in SDL_WaitEventTimeout; one wake-up covers any number of results
+    if (SDL_AtomicCAS(&ring->wake_pending, 0, 1)) {
+        SDL_Event event;
+        SDL_zero(event);
+        event.type = ring->event_type;
+        if (SDL_PushEvent(&event) <= 0) {
+            SDL_AtomicSet(&ring->wake_pending, 0);
+        }
+    }
+    return 1;
+}
+
+// Waits for a free slot rather than dropping the result; fails only once the ring is closed
+static int result_ring_push(ResultRing *ring, LoaderEventCode code, void *data) {
+    while (!result_ring_try_push(ring, code, data)) {
+        if (SDL_AtomicGet(&ring->closed)) {
+            return 0;
+        }
+        SDL_Delay(RESULT_RING_RETRY_MS);
+    }
+    return 1;
+}
+
+static int result_ring_pop(ResultRing *ring, ResultSlot *slot) {
+    unsigned int tail = (unsigned int)SDL_AtomicGet(&ring->tail);
+    if (tail == (unsigned int)SDL_AtomicGet(&ring->head)) {
+        return 0;
+    }
+
+    SDL_MemoryBarrierAcquire();
+    *slot = ring->slots[tail & (RESULT_RING_SLOTS - 1)];
+    // SDL_AtomicSet is only an acquire on some compilers; the slot must be read before it is handed back
+    SDL_MemoryBarrierRelease();
+    SDL_AtomicSet(&ring->tail, (int)(tail + 1));
+    return 1;
+}
+
+int result_ring_pending(ResultRing *ring) {
+    return SDL_AtomicGet(&ring->tail) != SDL_AtomicGet(&ring->head);
+}
+
+// Streaming decode functions
+ProgressiveImage *progressive_image_create(const char *filepath, int width, int height, ResultRing *results) {
+    ProgressiveImage *stream = NULL;
+    if (safe_malloc((void **)&stream, sizeof(ProgressiveImage)) != SECURITY_OK) {
+        return NULL;
+    }
+
+    stream->lock = SDL_CreateMutex();
+    if (!stream->lock) {
+        safe_free((void **)&stream);
+        return NULL;
+    }
+
+    secure_strncpy(stream->filepath, filepath, sizeof(stream->filepath));
+    stream->width = width;
+    stream->height = height;
+    stream->results = results;
+    return stream;
+}
+
+void progressive_image_free(ProgressiveImage *stream) {
+    if (!stream) {
+        return;
+    }
+
+    release_surface(stream->preview);
+    release_surface(stream->surface);
+    SDL_DestroyMutex(stream->lock);
+    secure_memzero(stream, sizeof(ProgressiveImage));
+    safe_free((void **)&stream);
+}
+
+#ifdef PHOTON_STREAMING_DECODE
+// Tells the main thread new pixels are ready; at most one notification is in the ring at a time,
+// and none is queued when the ring is full since a later one carries the same rows
+static void progressive_image_notify(ProgressiveImage *stream, int force) {
+    if (!stream) {
+        return;
+    }
+
+    Uint32 now = SDL_GetTicks();
+    if (!force && now - stream->last_notify < STREAM_NOTIFY_INTERVAL_MS) {
+        return;
+    }
+    if (!SDL_AtomicCAS(&stream->notify_pending, 0, 1)) {
+        return;
+    }
+
+    stream->last_notify = now;
+    if (!result_ring_try_push(stream->results, LOADER_EVENT_PROGRESS, stream)) {
+        SDL_AtomicSet(&stream->notify_pending, 0);
+    }
+}
+
+static void progressive_image_mark_rows(ProgressiveImage *stream, int top, int bottom) {
+    if (stream->dirty_bottom <= stream->dirty_top) {
+        stream->dirty_top = top;
+        stream->dirty_bottom = bottom;
+    } else {
+        stream->dirty_top = SDL_min(stream->dirty_top, top);
+        stream->dirty_bottom = SDL_max(stream->dirty_bottom, bottom);
+    }
+    stream->rows_visible = SDL_max(stream->rows_visible, bottom);
+}
+
+// Publishes the destination surface so the main thread can upload rows as they arrive
+static void progressive_image_attach(ProgressiveImage *stream, SDL_Surface *surface) {
+    SDL_LockMutex(stream->lock);
+    stream->surface = surface;
+    stream->rows_visible = 0;
+    stream->dirty_top = 0;
+    stream->dirty_bottom = 0;
+    SDL_UnlockMutex(stream->lock);
+}
+
+// Takes the finished surface back from the stream; the main thread stops reading it
+static SDL_Surface *progressive_image_detach(ProgressiveImage *stream) {
+    SDL_LockMutex(stream->lock);
+    SDL_Surface *surface = stream->surface;
+    stream->surface = NULL;
+    SDL_UnlockMutex(stream->lock);
+    return surface;
+}
+
+typedef struct {
+    struct jpeg_error_mgr base;
+    jmp_buf escape;
+} JpegErrorManager;
+
+static void jpeg_error_escape(j_common_ptr cinfo) {
+    JpegErrorManager *error = (JpegErrorManager *)cinfo->err;
+    longjmp(error->escape, 1);
+}
+
+static void jpeg_error_silent(j_common_ptr cinfo) {
+    (void)cinfo;
+}
+
+// DCT-scaled 1/8 decode of a baseline JPEG; cheap enough to paint before the full decode
+static SDL_Surface *decode_jpeg_preview(const MappedFile *file, PixelPool *pool) {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager error;
+    SDL_Surface *volatile preview = NULL;
+
+    cinfo.err = jpeg_std_error(&error.base);
+    error.base.error_exit = jpeg_error_escape;
+    error.base.output_message = jpeg_error_silent;
+    if (setjmp(error.escape)) {
+        jpeg_destroy_decompress(&cinfo);
+        release_surface(preview);
+        return NULL;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *)file->data, (unsigned long)file->size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = 8;
+    cinfo.dct_method = JDCT_IFAST;
+    cinfo.do_fancy_upsampling = FALSE;
+    jpeg_start_decompress(&cinfo);
+
+    preview = pixel_pool_create_surface(pool, (int)cinfo.output_width, (int)cinfo.output_height, 24,
+                                        SDL_PIXELFORMAT_RGB24);
+    if (!preview) {
+        jpeg_destroy_decompress(&cinfo);
+        return NULL;
+    }
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = (JSAMPROW)((Uint8 *)preview->pixels + (size_t)cinfo.output_scanline * preview->pitch);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return preview;
+}
+
+static void decode_jpeg_output_pass(struct jpeg_decompress_struct *cinfo, ProgressiveImage *stream,
+                                    SDL_Surface *surface, volatile int *locked) {
+    while (cinfo->output_scanline < cinfo->output_height) {
+        JSAMPROW rows[STREAM_ROW_BATCH];
+        int top = (int)cinfo->output_scanline;
+        int count = SDL_min(STREAM_ROW_BATCH, (int)cinfo->output_height - top);
+        for (int i = 0; i < count; i++) {
+            rows[i] = (JSAMPROW)((Uint8 *)surface->pixels + (size_t)(top + i) * surface->pitch);
+        }
+
+        SDL_LockMutex(stream->lock);
+        *locked = 1;
+        int read = (int)jpeg_read_scanlines(cinfo, rows, (JDIMENSION)count);
+        progressive_image_mark_rows(stream, top, top + read);
+        *locked = 0;
+        SDL_UnlockMutex(stream->lock);
+
+        progressive_image_notify(stream, 0);
+    }
+}
+
+// Decodes straight into a surface shared with the main thread. Baseline files get a 1/8
+// preview first and then fill in top to bottom; progressive files show their first scan.
+static int decode_jpeg_streaming(const MappedFile *file, ProgressiveImage *stream, PixelPool *pool,
+                                 SDL_Surface **out_surface) {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager error;
+    SDL_Surface *volatile surface = NULL;
+    volatile int locked = 0;
+
+    cinfo.err = jpeg_std_error(&error.base);
+    error.base.error_exit = jpeg_error_escape;
+    error.base.output_message = jpeg_error_silent;
+    if (setjmp(error.escape)) {
+        if (locked) {
+            SDL_UnlockMutex(stream->lock);
+        }
+        jpeg_destroy_decompress(&cinfo);
+        if (surface) {
+            release_surface(progressive_image_detach(stream));
+        }
+        return 0;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *)file->data, (unsigned long)file->size);
+    jpeg_read_header(&cinfo, TRUE);
+
+    // CMYK/YCCK and oversized images are left to SDL_image and its error reporting
+    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK ||
+        cinfo.image_width > MAX_IMAGE_DIMENSION || cinfo.image_height > MAX_IMAGE_DIMENSION) {
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    int progressive = jpeg_has_multiple_scans(&cinfo);
+    if (!progressive) {
+        SDL_Surface *preview = decode_jpeg_preview(file, pool);
+        if (preview) {
+            SDL_LockMutex(stream->lock);
+            stream->preview = preview;
+            SDL_UnlockMutex(stream->lock);
+            progressive_image_notify(stream, 1);
+        }
+    }
+
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.buffered_image = progressive ? TRUE : FALSE;
+    jpeg_start_decompress(&cinfo);
+
+    surface = pixel_pool_create_surface(pool, (int)cinfo.output_width, (int)cinfo.output_height, 24,
+                                        SDL_PIXELFORMAT_RGB24);
+    if (!surface) {
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+    progressive_image_attach(stream, surface);
+
+    if (progressive) {
+        // First scan for an early full-size frame, then one final pass once all scans are in
+        jpeg_start_output(&cinfo, cinfo.input_scan_number);
+        decode_jpeg_output_pass(&cinfo, stream, surface, &locked);
+        jpeg_finish_output(&cinfo);
+        progressive_image_notify(stream, 1);
+
+        while (!jpeg_input_complete(&cinfo)) {
+            if (jpeg_consume_input(&cinfo) == JPEG_SUSPENDED) {
+                break;
+            }
+        }
+        jpeg_start_output(&cinfo, cinfo.input_scan_number);
+        decode_jpeg_output_pass(&cinfo, stream, surface, &locked);
+        jpeg_finish_output(&cinfo);
+    } else {
+        decode_jpeg_output_pass(&cinfo, stream, surface, &locked);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    *out_surface = progressive_image_detach(stream);
+    return 1;
+}
+
+// Layout of a baseline JPEG whose restart markers let MCU-row bands decode independently
+typedef struct {
+    const Uint8 *data;
+    size_t sof_offset;
+    size_t sos_offset;
+    size_t scan_offset;
+    size_t scan_end;
+    int width;
+    int height;
+    int mcu_height;
+    int mcus_per_row;
+    int mcu_rows;
+    int restart_interval;
+    int rows_per_group;
+    size_t *intervals;
+    int interval_count;
+} JpegRestartLayout;
+
+typedef struct {
+    const JpegRestartLayout *layout;
+    SDL_Surface *surface;
+    int group_count;
+    int band_count;
+    SDL_atomic_t failed;
+} JpegBandJob;
+
+static int parse_jpeg_restart_layout(const MappedFile *file, JpegRestartLayout *layout) {
+    const Uint8 *data = file->data;
+    size_t size = file->size;
+    size_t pos = 2;
+    int components = 0;
+    int max_h = 1;
+    int max_v = 1;
+
+    secure_memzero(layout, sizeof(JpegRestartLayout));
+    layout->data = data;
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return 0;
+    }
+
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return 0;
+        }
+        Uint8 marker = data[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        size_t length = read_be16(data + pos + 2);
+        if (length < 2 || pos + 2 + length > size) {
+            return 0;
+        }
+        const Uint8 *segment = data + pos + 4;
+
+        if (marker == 0xC0 || marker == 0xC1) {
+            if (length < 8) {
+                return 0;
+            }
+            layout->sof_offset = pos;
+            layout->height = read_be16(segment + 1);
+            layout->width = read_be16(segment + 3);
+            components = segment[5];
+            if ((components != 1 && components != 3) || length < 8 + (size_t)components * 3) {
+                return 0;
+            }
+            for (int i = 0; i < components; i++) {
+                max_h = SDL_max(max_h, segment[6 + i * 3 + 1] >> 4);
+                max_v = SDL_max(max_v, segment[6 + i * 3 + 1] & 0x0F);
+            }
+        } else if (marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            // Progressive, lossless and arithmetic-coded frames have no independent bands
+            return 0;
+        } else if (marker == 0xDD && length >= 4) {
+            layout->restart_interval = read_be16(segment);
+        } else if (marker == 0xDA) {
+            // Only a single interleaved scan carries every component between restart markers
+            if (layout->sof_offset == 0 || length < 3 || segment[0] != components) {
+                return 0;
+            }
+            layout->sos_offset = pos;
+            layout->scan_offset = pos + 2 + length;
+            break;
+        }
+        pos += 2 + length;
+    }
+
+    if (layout->scan_offset == 0 || layout->restart_interval == 0 || layout->width <= 0 || layout->height <= 0 ||
+        layout->width > MAX_IMAGE_DIMENSION || layout->height > MAX_IMAGE_DIMENSION) {
+        return 0;
+    }
+
+    layout->mcu_height = 8 * max_v;
+    layout->mcus_per_row = (layout->width + 8 * max_h - 1) / (8 * max_h);
+    layout->mcu_rows = (layout->height + layout->mcu_height - 1) / layout->mcu_height;
+
+    // Bands start on MCU rows that are also restart boundaries
+    if (layout->mcus_per_row % layout->restart_interval == 0) {
+        layout->rows_per_group = 1;
+    } else if (layout->restart_interval % layout->mcus_per_row == 0) {
+        layout->rows_per_group = layout->restart_interval / layout->mcus_per_row;
+    } else {
+        return 0;
+    }
+
+    long long total_mcus = (long long)layout->mcus_per_row * layout->mcu_rows;
+    long long expected = (total_mcus + layout->restart_interval - 1) / layout->restart_interval;
+    if (safe_malloc_uninitialized((void **)&layout->intervals, (size_t)expected * sizeof(size_t)) != SECURITY_OK) {
+        return 0;
+    }
+
+    // Record where each restart interval begins; the scan must end in EOI, not another scan
+    layout->intervals[layout->interval_count++] = layout->scan_offset;
+    pos = layout->scan_offset;
+    while (pos + 1 < size) {
+        if (data[pos] != 0xFF || data[pos + 1] == 0x00 || data[pos + 1] == 0xFF) {
+            pos++;
+            continue;
+        }
+        Uint8 marker = data[pos + 1];
+        if (marker >= 0xD0 && marker <= 0xD7) {
+            if (layout->interval_count >= expected) {
+                break;
+            }
+            layout->intervals[layout->interval_count++] = pos + 2;
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9) {
+            layout->scan_end = pos;
+        }
+        break;
+    }
+
+    if (layout->scan_end == 0 || layout->interval_count != expected) {
+        safe_free((void **)&layout->intervals);
+        return 0;
+    }
+    return 1;
+}
+
+// Rebuilds a standalone JPEG for MCU rows [first_row, end_row): the original tables, a SOF
+// with the band height, and the band's restart intervals renumbered from RST0
+static Uint8 *build_jpeg_band(const JpegRestartLayout *layout, int first_row, int end_row, size_t *out_size) {
+    long long first_mcu = (long long)first_row * layout->mcus_per_row;
+    long long end_mcu = SDL_min((long long)end_row * layout->mcus_per_row,
+                                (long long)layout->mcu_rows * layout->mcus_per_row);
+    int first_interval = (int)(first_mcu / layout->restart_interval);
+    int end_interval = (int)((end_mcu + layout->restart_interval - 1) / layout->restart_interval);
+
+    size_t header_size = layout->scan_offset;
+    size_t scan_start = layout->intervals[first_interval];
+    size_t scan_stop = end_interval < layout->interval_count ? layout->intervals[end_interval] : layout->scan_end;
+    size_t size = header_size + (scan_stop - scan_start) + 2;
+
+    Uint8 *band = NULL;
+    if (safe_malloc_uninitialized((void **)&band, size) != SECURITY_OK) {
+        return NULL;
+    }
+
+    memcpy(band, layout->data, header_size);
+    int band_height = SDL_min((end_row - first_row) * layout->mcu_height,
+                              layout->height - first_row * layout->mcu_height);
+    band[layout->sof_offset + 5] = (Uint8)(band_height >> 8);
+    band[layout->sof_offset + 6] = (Uint8)(band_height & 0xFF);
+
+    size_t out = header_size;
+    for (int i = first_interval; i < end_interval; i++) {
+        size_t start = layout->intervals[i];
+        size_t stop = i + 1 < layout->interval_count ? layout->intervals[i + 1] - 2 : layout->scan_end;
+        memcpy(band + out, layout->data + start, stop - start);
+        out += stop - start;
+        if (i + 1 < end_interval) {
+            band[out++] = 0xFF;
+            band[out++] = (Uint8)(0xD0 + ((i - first_interval) & 7));
+        }
+    }
+    band[out++] = 0xFF;
+    band[out++] = 0xD9;
+
+    *out_size = out;
+    return band;
+}
+
+// Writes output rows [keep_top, keep_bottom) of a band starting at image row band_top
+static int decode_jpeg_band_rows(const Uint8 *band, size_t band_size, SDL_Surface *surface, int band_top,
+                                 int keep_top, int keep_bottom, Uint8 *scratch) {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager error;
+    cinfo.err = jpeg_std_error(&error.base);
+    error.base.error_exit = jpeg_error_escape;
+    error.base.output_message = jpeg_error_silent;
+    if (setjmp(error.escape)) {
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *)band, (unsigned long)band_size);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&cinfo);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        int y = band_top + (int)cinfo.output_scanline;
+        JSAMPROW row = (y >= keep_top && y < keep_bottom)
+                           ? (JSAMPROW)((Uint8 *)surface->pixels + (size_t)y * surface->pitch)
+                           : (JSAMPROW)scratch;
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    return 1;
+}
+
+// Decodes one band with a restart group of context on each side, so chroma upsampling at the
+// seams sees the same neighbours as a whole-image decode; only the band's own rows are kept
+static void decode_jpeg_band(void *context, int index) {
+    JpegBandJob *job = (JpegBandJob *)context;
+    const JpegRestartLayout *layout = job->layout;
+
+    if (SDL_AtomicGet(&job->failed)) {
+        return;
+    }
+
+    int first_group = (int)((long long)job->group_count * index / job->band_count);
+    int end_group = (int)((long long)job->group_count * (index + 1) / job->band_count);
+    int keep_top = first_group * layout->rows_per_group * layout->mcu_height;
+    int keep_bottom = SDL_min(end_group * layout->rows_per_group * layout->mcu_height, layout->height);
+    int first_row = SDL_max(first_group - 1, 0) * layout->rows_per_group;
+    int end_row = SDL_min((end_group + 1) * layout->rows_per_group, layout->mcu_rows);
+
+    size_t band_size = 0;
+    Uint8 *band = build_jpeg_band(layout, first_row, end_row, &band_size);
+    Uint8 *scratch = NULL;
+    int decoded = band &&
+                  safe_malloc_uninitialized((void **)&scratch, (size_t)job->surface->pitch) == SECURITY_OK &&
+                  decode_jpeg_band_rows(band, band_size, job->surface, first_row * layout->mcu_height,
+                                        keep_top, keep_bottom, scratch);
+    if (!decoded) {
+        SDL_AtomicSet(&job->failed, 1);
+    }
+
+    safe_free((void **)&band);
+    safe_free((void **)&scratch);
+}
+
+typedef struct {
+    const Uint8 *data;
+    size_t size;
+    size_t offset;
+} PngMemoryReader;
+
+static void png_read_memory(png_structp png, png_bytep out, png_size_t length) {
+    PngMemoryReader *reader = (PngMemoryReader *)png_get_io_ptr(png);
+    if (length > reader->size - reader->offset) {
+        png_error(png, "Truncated PNG");
+    }
+    memcpy(out, reader->data + reader->offset, length);
+    reader->offset += length;
+}
+
+static void png_error_escape(png_structp png, png_const_charp message) {
+    (void)message;
+    png_longjmp(png, 1);
+}
+
+static void png_warning_silent(png_structp png, png_const_charp message) {
+    (void)png;
+    (void)message;
+}
+
+// Normalizes any PNG to 8-bit RGB or RGBA; returns the channel count, or 0 when it is neither
+static int png_set_rgb_output(png_structp png, png_infop info, int *passes) {
+    int color_type = png_get_color_type(png, info);
+    int bit_depth = png_get_bit_depth(png, info);
+    if (color_type == PNG_COLOR_TYPE_PALETTE) {
+        png_set_palette_to_rgb(png);
+    }
+    if (color_type == PNG_COLOR_TYPE_GRAY && bit_depth < 8) {
+        png_set_expand_gray_1_2_4_to_8(png);
+    }
+    if (png_get_valid(png, info, PNG_INFO_tRNS)) {
+        png_set_tRNS_to_alpha(png);
+    }
+    if (bit_depth == 16) {
+        png_set_strip_16(png);
+    }
+    if (color_type == PNG_COLOR_TYPE_GRAY || color_type == PNG_COLOR_TYPE_GRAY_ALPHA) {
+        png_set_gray_to_rgb(png);
+    }
+    *passes = png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    int channels = png_get_channels(png, info);
+    return channels == 3 || channels == 4 ? channels : 0;
+}
+
+// Row-by-row PNG decode into a shared surface; interlaced files refine once per Adam7 pass
+static int decode_png_streaming(const MappedFile *file, ProgressiveImage *stream, PixelPool *pool,
+                                SDL_Surface **out_surface) {
+    PngMemoryReader reader = {file->data, file->size, 0};
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_error_escape, png_warning_silent);
+    if (!png) {
+        return 0;
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, NULL, NULL);
+        return 0;
+    }
+
+    SDL_Surface *volatile surface = NULL;
+    volatile int locked = 0;
+    if (setjmp(png_jmpbuf(png))) {
+        if (locked) {
+            SDL_UnlockMutex(stream->lock);
+        }
+        png_destroy_read_struct(&png, &info, NULL);
+        if (surface) {
+            release_surface(progressive_image_detach(stream));
+        }
+        return 0;
+    }
+
+    png_set_read_fn(png, &reader, png_read_memory);
+    png_read_info(png, info);
+
+    png_uint_32 width = png_get_image_width(png, info);
+    png_uint_32 height = png_get_image_height(png, info);
+    int passes = 0;
+    int channels = png_set_rgb_output(png, info, &passes);
+    if (width == 0 || height == 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION || !channels) {
+        png_destroy_read_struct(&png, &info, NULL);
+        return 0;
+    }
+
+    surface = pixel_pool_create_surface(pool, (int)width, (int)height, channels * 8,
+                                        channels == 4 ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24);
+    if (!surface) {
+        png_destroy_read_struct(&png, &info, NULL);
+        return 0;
+    }
+    progressive_image_attach(stream, surface);
+
+    for (int pass = 0; pass < passes; pass++) {
+        for (int top = 0; top < (int)height; top += STREAM_ROW_BATCH) {
+            int bottom = SDL_min(top + STREAM_ROW_BATCH, (int)height);
+
+            SDL_LockMutex(stream->lock);
+            locked = 1;
+            for (int y = top; y < bottom; y++) {
+                png_read_row(png, (png_bytep)surface->pixels + (size_t)y * surface->pitch, NULL);
+            }
+            progressive_image_mark_rows(stream, top, bottom);
+            locked = 0;
+            SDL_UnlockMutex(stream->lock);
+
+            progressive_image_notify(stream, 0);
+        }
+    }
+
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+
+    *out_surface = progressive_image_detach(stream);
+    return 1;
+}
+
+// DCT-domain downscale: libjpeg produces 1/factor size directly, skipping most of the IDCT work
+static int decode_jpeg_reduced(const MappedFile *file, PixelPool *pool, int factor, SDL_Surface **out_surface) {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorManager error;
+    SDL_Surface *volatile surface = NULL;
+
+    cinfo.err = jpeg_std_error(&error.base);
+    error.base.error_exit = jpeg_error_escape;
+    error.base.output_message = jpeg_error_silent;
+    if (setjmp(error.escape)) {
+        jpeg_destroy_decompress(&cinfo);
+        release_surface(surface);
+        return 0;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_mem_src(&cinfo, (unsigned char *)file->data, (unsigned long)file->size);
+    jpeg_read_header(&cinfo, TRUE);
+    if (cinfo.jpeg_color_space == JCS_CMYK || cinfo.jpeg_color_space == JCS_YCCK ||
+        cinfo.image_width > MAX_IMAGE_DIMENSION || cinfo.image_height > MAX_IMAGE_DIMENSION) {
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    cinfo.out_color_space = JCS_RGB;
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = (unsigned int)factor;
+    jpeg_start_decompress(&cinfo);
+
+    surface = pixel_pool_create_surface(pool, (int)cinfo.output_width, (int)cinfo.output_height, 24,
+                                        SDL_PIXELFORMAT_RGB24);
+    if (!surface) {
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JSAMPROW row = (JSAMPROW)((Uint8 *)surface->pixels + (size_t)cinfo.output_scanline * surface->pitch);
+        jpeg_read_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+    *out_surface = surface;
+    return 1;
+}
+
+// Averages factor x factor blocks as rows are inflated, so only one row of the full-size image
+// is ever held. Interlaced files need every pass before a row is final and are not reduced.
+static int decode_png_reduced(const MappedFile *file, PixelPool *pool, int factor, SDL_Surface **out_surface) {
+    PngMemoryReader reader = {file->data, file->size, 0};
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_error_escape, png_warning_silent);
+    if (!png) {
+        return 0;
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, NULL, NULL);
+        return 0;
+    }
+
+    SDL_Surface *volatile surface = NULL;
+    Uint8 *volatile row = NULL;
+    Uint32 *volatile sums = NULL;
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, NULL);
+        release_surface(surface);
+        safe_free((void **)&row);
+        safe_free((void **)&sums);
+        return 0;
+    }
+
+    png_set_read_fn(png, &reader, png_read_memory);
+    png_read_info(png, info);
+
+    int width = (int)png_get_image_width(png, info);
+    int height = (int)png_get_image_height(png, info);
+    int passes = 0;
+    int channels = png_set_rgb_output(png, info, &passes);
+    if (width <= 0 || height <= 0 || width > MAX_IMAGE_DIMENSION || height > MAX_IMAGE_DIMENSION ||
+        !channels || passes != 1) {
+        png_destroy_read_struct(&png, &info, NULL);
+        return 0;
+    }
+
+    int out_width = (width + factor - 1) / factor;
+    int out_height = (height + factor - 1) / factor;
+    surface = pixel_pool_create_surface(pool, out_width, out_height, channels * 8,
+                                        channels == 4 ? SDL_PIXELFORMAT_RGBA32 : SDL_PIXELFORMAT_RGB24);
+    if (!surface ||
+        safe_malloc_uninitialized((void **)&row, (size_t)width * (size_t)channels) != SECURITY_OK ||
+        safe_calloc((void **)&sums, (size_t)out_width * (size_t)channels, sizeof(Uint32)) != SECURITY_OK) {
+        png_destroy_read_struct(&png, &info, NULL);
+        release_surface(surface);
+        safe_free((void **)&row);
+        return 0;
+    }
+
+    for (int y = 0; y < height; y++) {
+        png_read_row(png, row, NULL);
+        for (int x = 0; x < width; x++) {
+            Uint32 *sum = sums + (size_t)(x / factor) * channels;
+            const Uint8 *pixel = row + (size_t)x * channels;
+            for (int c = 0; c < channels; c++) {
+                sum[c] += pixel[c];
+            }
+        }
+
+        // Edge blocks cover fewer source pixels and are averaged over what they have
+        if ((y + 1) % factor != 0 && y + 1 != height) {
+            continue;
+        }
+        int block_rows = y % factor + 1;
+        Uint8 *out = (Uint8 *)surface->pixels + (size_t)(y / factor) * surface->pitch;
+        for (int x = 0; x < out_width; x++) {
+            Uint32 count = (Uint32)(block_rows * SDL_min(factor, width - x * factor));
+            for (int c = 0; c < channels; c++) {
+                Uint32 *sum = &sums[(size_t)x * channels + c];
+                out[(size_t)x * channels + c] = (Uint8)((*sum + count / 2) / count);
+                *sum = 0;
+            }
+        }
+    }
+
+    png_read_end(png, NULL);
+    png_destroy_read_struct(&png, &info, NULL);
+    safe_free((void **)&row);
+    safe_free((void **)&sums);
+    *out_surface = surface;
+    return 1;
+}
+#endif
+
+// Band-parallel decode of large restart-marked baseline JPEGs; returns 0 to use another decoder
+int decode_image_parallel(const MappedFile *file, WorkerPool *workers, PixelPool *pool, SDL_Surface **out_surface) {
+    if (!file || !file->data || !workers || !out_surface || workers->thread_count == 0) {
+        return 0;
+    }
+
+#ifdef PHOTON_STREAMING_DECODE
+    JpegRestartLayout layout;
+    if (!parse_jpeg_restart_layout(file, &layout)) {
+        return 0;
+    }
+
+    JpegBandJob job;
+    secure_memzero(&job, sizeof(job));
+    job.layout = &layout;
+    job.group_count = (layout.mcu_rows + layout.rows_per_group - 1) / layout.rows_per_group;
+    job.band_count = SDL_min(job.group_count, (workers->thread_count + 1) * PARALLEL_BANDS_PER_THREAD);
+    if ((long long)layout.width * layout.height < PARALLEL_DECODE_MIN_PIXELS || job.band_count < 2) {
+        safe_free((void **)&layout.intervals);
+        return 0;
+    }
+
+    job.surface = pixel_pool_create_surface(pool, layout.width, layout.height, 24, SDL_PIXELFORMAT_RGB24);
+    if (!job.surface) {
+        safe_free((void **)&layout.intervals);
+        return 0;
+    }
+
+    worker_pool_run(workers, decode_jpeg_band, &job, job.band_count);
+    safe_free((void **)&layout.intervals);
+
+    if (SDL_AtomicGet(&job.failed)) {
+        release_surface(job.surface);
+        return 0;
+    }
+
+    *out_surface = job.surface;
+    return 1;
+#else
+    (void)pool;
+    return 0;
+#endif
+}
+
+// Streams JPEG/PNG when built with PHOTON_STREAMING_DECODE; returns 0 to fall back to SDL_image
+int decode_image_streaming(const MappedFile *file, const ImageMetadata *metadata, ProgressiveImage *stream,
+                           PixelPool *pool, SDL_Surface **out_surface) {
+    if (!file || !metadata || !stream || !out_surface) {
+        return 0;
+    }
+    (void)pool;
+
+#ifdef PHOTON_STREAMING_DECODE
+    if (strcmp(metadata->format, "JPEG") == 0) {
+        return decode_jpeg_streaming(file, stream, pool, out_surface);
+    }
+    if (strcmp(metadata->format, "PNG") == 0) {
+        return decode_png_streaming(file, stream, pool, out_surface);
+    }
+#endif
+
+    return 0;
+}
+
+// Largest power-of-two reduction that keeps the image at least as large as it is drawn when
+// fitted into target_width x target_height; 1 means decode at full size
+int decode_reduction_for(int width, int height, int target_width, int target_height) {
+    if (width <= 0 || height <= 0 || target_width <= 0 || target_height <= 0) {
+        return 1;
+    }
+
+    double scale = SDL_min((double)target_width / width, (double)target_height / height);
+    if (scale >= 1.0) {
+        return 1;
+    }
+
+    int fitted_width = (int)(width * scale + 0.999);
+    int fitted_height = (int)(height * scale + 0.999);
+    int factor = 1;
+    while (factor < DECODE_MAX_REDUCTION &&
+           (width + factor * 2 - 1) / (factor * 2) >= fitted_width &&
+           (height + factor * 2 - 1) / (factor * 2) >= fitted_height) {
+        factor *= 2;
+    }
+    return factor;
+}
+
+// Decodes JPEG/PNG straight to a reduced size for a fitted view; returns 0 when the image is
+// not large enough to gain from it or the format has no reduced path
+int decode_image_reduced(const MappedFile *file, const ImageMetadata *metadata, PixelPool *pool, int target_width,
+                         int target_height, SDL_Surface **out_surface) {
+    if (!file || !file->data || !metadata || !out_surface) {
+        return 0;
+    }
+
+    int factor = decode_reduction_for(metadata->width, metadata->height, target_width, target_height);
+    if (factor == 1) {
+        return 0;
+    }
+    (void)pool;
+
+#ifdef PHOTON_STREAMING_DECODE
+    if (strcmp(metadata->format, "JPEG") == 0) {
+        return decode_jpeg_reduced(file, pool, factor, out_surface);
+    }
+    if (strcmp(metadata->format, "PNG") == 0) {
+        return decode_png_reduced(file, pool, factor, out_surface);
+    }
+#endif
+
+    return 0;
+}
+
+// Image loading functions
+SecurityResult decode_image_mapped(const MappedFile *file, const char *image_path, SDL_Surface **out_surface) {
+    if (!file || !file->data || !image_path || !out_surface) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    *out_surface = NULL;
+
+    SDL_RWops *rw = SDL_RWFromConstMem(file->data, (int)file->size);
+    if (!rw) {
+        return SECURITY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    // The extension is only a hint for formats without a signature (e.g. TGA)
+    const char *ext = strrchr(image_path, '.');
+    SDL_Surface *surface = IMG_LoadTyped_RW(rw, 1, ext ? ext + 1 : NULL);
+    if (!surface) {
+        return SECURITY_ERROR_ACCESS_DENIED;
+    }
+
+    if (surface->w <= 0 || surface->h <= 0 || surface->w > MAX_IMAGE_DIMENSION || surface->h > MAX_IMAGE_DIMENSION) {
+        SDL_FreeSurface(surface);
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    *out_surface = surface;
+    return SECURITY_OK;
+}
+
+SecurityResult decode_image_secure(const char *image_path, WorkerPool *workers, PixelPool *pool,
+                                   SDL_Surface **out_surface) {
+    if (!image_path || !out_surface) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    *out_surface = NULL;
+
+    SecurityResult result = validate_filepath(image_path);
+    if (result != SECURITY_OK) {
+        return result;
+    }
+
+    MappedFile file;
+    result = map_file(image_path, &file);
+    if (result != SECURITY_OK) {
+        return result;
+    }
+
+    if (!decode_image_parallel(&file, workers, pool, out_surface)) {
+        result = decode_image_mapped(&file, image_path, out_surface);
+    }
+    unmap_file(&file);
+    return result;
+}
+
+// Averages each 2x2 block of a 32-bit surface; odd edges reuse the last row/column
+static SDL_Surface *downsample_surface_2x(PixelPool *pool, SDL_Surface *source) {
+    int width = (source->w + 1) / 2;
+    int height = (source->h + 1) / 2;
+    SDL_Surface *target = pixel_pool_create_surface(pool, width, height, 32, source->format->format);
+    if (!target) {
+        return NULL;
+    }
+
+    if (SDL_MUSTLOCK(source)) {
+        SDL_LockSurface(source);
+    }
+
+    for (int y = 0; y < height; y++) {
+        const Uint8 *row0 = (const Uint8 *)source->pixels + (size_t)(y * 2) * source->pitch;
+        const Uint8 *row1 = (const Uint8 *)source->pixels + (size_t)SDL_min(y * 2 + 1, source->h - 1) * source->pitch;
+        Uint8 *out = (Uint8 *)target->pixels + (size_t)y * target->pitch;
+
+        for (int x = 0; x < width; x++) {
+            int x0 = x * 8;
+            int x1 = SDL_min(x * 2 + 1, source->w - 1) * 4;
+            for (int c = 0; c < 4; c++) {
+                out[x * 4 + c] = (Uint8)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+            }
+        }
+    }
+
+    if (SDL_MUSTLOCK(source)) {
+        SDL_UnlockSurface(source);
+    }
+
+    return target;
+}
+
+// Fills levels[1..] with reductions of levels[0]; returns the total level count
+int build_mip_levels(PixelPool *pool, SDL_Surface **levels, int max_levels) {
+    if (!levels || !levels[0] || max_levels < 1) {
+        return 0;
+    }
+
+    int count = 1;
+    SDL_Surface *current = levels[0];
+    SDL_Surface *converted = NULL;
+
+    if (SDL_max(current->w, current->h) > MIP_MIN_DIMENSION && current->format->BytesPerPixel != 4) {
+        converted = convert_surface_format(pool, current, SDL_PIXELFORMAT_ARGB8888);
+        if (!converted) {
+            return count;
+        }
+        current = converted;
+    }
+
+    while (count < max_levels && SDL_max(current->w, current->h) > MIP_MIN_DIMENSION) {
+        SDL_Surface *next = downsample_surface_2x(pool, current);
+        if (!next) {
+            break;
+        }
+        levels[count++] = next;
+        current = next;
+    }
+
+    release_surface(converted);
+
+    return count;
+}
+
+void free_surface_levels(SDL_Surface **levels, int count) {
+    for (int i = 0; i < count; i++) {
+        release_surface(levels[i]);
+        levels[i] = NULL;
+    }
+}
+
+// Texture upload functions
+static int texture_format_supported(const TextureFormatList *list, Uint32 format) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->formats[i] == format) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Picks the renderer format that is cheapest to fill from the surface: its own format when the
+// renderer takes it, otherwise the closest 32-bit layout. UNKNOWN leaves the upload to SDL.
+Uint32 choose_texture_format(const TextureFormatList *list, SDL_Surface *surface) {
+    static const Uint32 alpha_formats[] = {SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888,
+                                           SDL_PIXELFORMAT_RGBA8888, SDL_PIXELFORMAT_BGRA8888};
+    static const Uint32 opaque_formats[] = {SDL_PIXELFORMAT_RGB888, SDL_PIXELFORMAT_BGR888,
+                                            SDL_PIXELFORMAT_ARGB8888, SDL_PIXELFORMAT_ABGR8888};
+
+    if (!list || !surface || list->count == 0) {
+        return SDL_PIXELFORMAT_UNKNOWN;
+    }
+
+    // Palettes and color keys need SDL's expansion to an alpha format
+    Uint32 format = surface->format->format;
+    Uint32 color_key = 0;
+    if (SDL_ISPIXELFORMAT_INDEXED(format) || SDL_ISPIXELFORMAT_FOURCC(format) ||
+        SDL_GetColorKey(surface, &color_key) == 0) {
+        return SDL_PIXELFORMAT_UNKNOWN;
+    }
+
+    if (texture_format_supported(list, format)) {
+        return format;
+    }
+
+    const Uint32 *candidates = SDL_ISPIXELFORMAT_ALPHA(format) ? alpha_formats : opaque_formats;
+    for (int i = 0; i < 4; i++) {
+        if (texture_format_supported(list, candidates[i])) {
+            return candidates[i];
+        }
+    }
+
+    return SDL_PIXELFORMAT_UNKNOWN;
+}
+
+// Converts pixels straight into the locked texture memory; a plain row copy when formats match
+int texture_upload_pixels(SDL_Texture *texture, Uint32 texture_format, const SDL_Rect *rect,
+                          const void *pixels, int pitch, Uint32 pixel_format) {
+    void *target = NULL;
+    int target_pitch = 0;
+    if (SDL_LockTexture(texture, rect, &target, &target_pitch) != 0) {
+        return 0;
+    }
+
+    int converted = convert_pixels(rect->w, rect->h, pixel_format, pixels, pitch,
+                                   texture_format, target, target_pitch) == 0;
+    SDL_UnlockTexture(texture);
+    return converted;
+}
+
+SDL_Texture *create_texture_from_pixels(SDL_Renderer *renderer, Uint32 texture_format, const void *pixels,
+                                        int pitch, Uint32 pixel_format, int width, int height) {
+    SDL_Texture *texture = SDL_CreateTexture(renderer, texture_format, SDL_TEXTUREACCESS_STREAMING, width, height);
+    if (!texture) {
+        return NULL;
+    }
+
+    SDL_Rect rect = {0, 0, width, height};
+    if (!texture_upload_pixels(texture, texture_format, &rect, pixels, pitch, pixel_format)) {
+        SDL_DestroyTexture(texture);
+        return NULL;
+    }
+
+    // Same blending SDL_CreateTextureFromSurface would pick
+    if (SDL_ISPIXELFORMAT_ALPHA(pixel_format)) {
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    }
+    return texture;
+}
+
+// Tiled texture functions
+void tiled_texture_destroy(TiledTexture *image) {
+    if (!image || !image->tiles) {
+        return;
+    }
+
+    for (int i = 0; i < image->columns * image->rows; i++) {
+        if (image->tiles[i]) {
+            SDL_DestroyTexture(image->tiles[i]);
+        }
+    }
+    safe_free((void **)&image->tiles);
+    secure_memzero(image, sizeof(TiledTexture));
+}
+
+// Refills a recycled tile in place when its size and format still fit, otherwise creates one
+static SDL_Texture *create_tile_texture(SDL_Renderer *renderer, SDL_Texture **recycled, Uint32 texture_format,
+                                        const void *pixels, int pitch, Uint32 pixel_format, int width, int height) {
+    if (recycled && *recycled) {
+        SDL_Texture *texture = *recycled;
+        SDL_Rect rect = {0, 0, width, height};
+        Uint32 format = 0;
+        int access = 0;
+        int w = 0;
+        int h = 0;
+        if (SDL_QueryTexture(texture, &format, &access, &w, &h) == 0 && format == texture_format &&
+            access == SDL_TEXTUREACCESS_STREAMING && w == width && h == height &&
+            texture_upload_pixels(texture, texture_format, &rect, pixels, pitch, pixel_format)) {
+            SDL_SetTextureBlendMode(texture, SDL_ISPIXELFORMAT_ALPHA(pixel_format) ? SDL_BLENDMODE_BLEND
+                                                                                    : SDL_BLENDMODE_NONE);
+            *recycled = NULL;
+            return texture;
+        }
+    }
+
+    return create_texture_from_pixels(renderer, texture_format, pixels, pitch, pixel_format, width, height);
+}
+
+// Uploads the surface as a grid of textures no larger than the renderer's limits. Matching
+// tiles are taken from recycle when given; whatever is left there stays owned by the caller.
+SecurityResult tiled_texture_create(SDL_Renderer *renderer, SDL_Surface *surface, int max_tile_width,
+                                    int max_tile_height, const TextureFormatList *formats,
+                                    TiledTexture *recycle, TiledTexture *out) {
+    if (!renderer || !surface || !out) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    secure_memzero(out, sizeof(TiledTexture));
+    out->width = surface->w;
+    out->height = surface->h;
+    out->tile_width = (max_tile_width > 0 && max_tile_width < surface->w) ? max_tile_width : surface->w;
+    out->tile_height = (max_tile_height > 0 && max_tile_height < surface->h) ? max_tile_height : surface->h;
+    out->columns = (surface->w + out->tile_width - 1) / out->tile_width;
+    out->rows = (surface->h + out->tile_height - 1) / out->tile_height;
+
+    SecurityResult allocated = safe_calloc((void **)&out->tiles, (size_t)(out->columns * out->rows),
+                                           sizeof(SDL_Texture *));
+    if (allocated != SECURITY_OK) {
+        return allocated;
+    }
+
+    Uint32 texture_format = choose_texture_format(formats, surface);
+    SDL_Texture **recycled = NULL;
+    if (recycle && recycle->tiles && recycle->columns == out->columns && recycle->rows == out->rows) {
+        recycled = recycle->tiles;
+    }
+
+    if (out->columns == 1 && out->rows == 1) {
+        if (texture_format != SDL_PIXELFORMAT_UNKNOWN && !SDL_MUSTLOCK(surface)) {
+            out->tiles[0] = create_tile_texture(renderer, recycled, texture_format, surface->pixels,
+                                                surface->pitch, surface->format->format, surface->w, surface->h);
+        }
+        if (!out->tiles[0]) {
+            out->tiles[0] = SDL_CreateTextureFromSurface(renderer, surface);
+        }
+        if (!out->tiles[0]) {
+            tiled_texture_destroy(out);
+            return SECURITY_ERROR_MEMORY_ALLOCATION;
+        }
+        return SECURITY_OK;
+    }
+
+    // Tiles are sub-surface views into the decoded pixels, so sub-byte formats are widened first
+    SDL_Surface *source = surface;
+    if (surface->format->BitsPerPixel < 8) {
+        source = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_ARGB8888, 0);
+        if (!source) {
+            tiled_texture_destroy(out);
+            return SECURITY_ERROR_MEMORY_ALLOCATION;
+        }
+    }
+
+    Uint32 color_key = 0;
+    int has_color_key = SDL_GetColorKey(source, &color_key) == 0;
+    SecurityResult result = SECURITY_OK;
+
+    if (SDL_MUSTLOCK(source)) {
+        SDL_LockSurface(source);
+    }
+
+    for (int row = 0; row < out->rows && result == SECURITY_OK; row++) {
+        for (int column = 0; column < out->columns; column++) {
+            int x = column * out->tile_width;
+            int y = row * out->tile_height;
+            int w = SDL_min(out->tile_width, source->w - x);
+            int h = SDL_min(out->tile_height, source->h - y);
+            Uint8 *pixels = (Uint8 *)source->pixels + (size_t)y * source->pitch +
+                            (size_t)x * source->format->BytesPerPixel;
+
+            if (texture_format != SDL_PIXELFORMAT_UNKNOWN && source == surface) {
+                SDL_Texture *tile = create_tile_texture(renderer,
+                                                        recycled ? &recycled[row * out->columns + column] : NULL,
+                                                        texture_format, pixels, source->pitch,
+                                                        source->format->format, w, h);
+                if (tile) {
+                    out->tiles[row * out->columns + column] = tile;
+                    continue;
+                }
+            }
+
+            SDL_Surface *view = SDL_CreateRGBSurfaceWithFormatFrom(
+                pixels, w, h, source->format->BitsPerPixel, source->pitch, source->format->format);
+            if (!view) {
+                result = SECURITY_ERROR_MEMORY_ALLOCATION;
+                break;
+            }
+            if (source->format->palette) {
+                SDL_SetSurfacePalette(view, source->format->palette);
+            }
+            if (has_color_key) {
+                SDL_SetColorKey(view, SDL_TRUE, color_key);
+            }
+
+            out->tiles[row * out->columns + column] = SDL_CreateTextureFromSurface(renderer, view);
+            SDL_FreeSurface(view);
+            if (!out->tiles[row * out->columns + column]) {
+                result = SECURITY_ERROR_MEMORY_ALLOCATION;
+                break;
+            }
+        }
+    }
+
+    if (SDL_MUSTLOCK(source)) {
+        SDL_UnlockSurface(source);
+    }
+    if (source != surface) {
+        SDL_FreeSurface(source);
+    }
+    if (result != SECURITY_OK) {
+        tiled_texture_destroy(out);
+    }
+
+    return result;
+}
+
+// EXIF orientations as SDL_RenderCopyEx applies them: mirrored first, then turned clockwise.
+// 5 and 7 are the transpose and transverse, a mirror followed by a quarter turn.
+int orientation_swaps_axes(int orientation) {
+    return orientation >= 5 && orientation <= 8;
+}
+
+static double orientation_angle(int orientation) {
+    return orientation == 3 ? 180.0 : orientation == 8 ? 270.0 : orientation_swaps_axes(orientation) ? 90.0 : 0.0;
+}
+
+static SDL_RendererFlip orientation_flip(int orientation) {
+    return (orientation == 2 || orientation == 7) ? SDL_FLIP_HORIZONTAL
+         : (orientation == 4 || orientation == 5) ? SDL_FLIP_VERTICAL : SDL_FLIP_NONE;
+}
+
+// Corner of the stored image, each coordinate 0 or 1, that orientation shows at display corner
+// (x, y); turns a quad by permuting its texture coordinates
+void orientation_source_corner(int orientation, int x, int y, int *source_x, int *source_y) {
+    switch (orientation) {
+        case 2:
+            *source_x = 1 - x;
+            *source_y = y;
+            break;
+        case 3:
+            *source_x = 1 - x;
+            *source_y = 1 - y;
+            break;
+        case 4:
+            *source_x = x;
+            *source_y = 1 - y;
+            break;
+        case 5:
+            *source_x = y;
+            *source_y = x;
+            break;
+        case 6:
+            *source_x = y;
+            *source_y = 1 - x;
+            break;
+        case 7:
+            *source_x = 1 - y;
+            *source_y = 1 - x;
+            break;
+        case 8:
+            *source_x = 1 - y;
+            *source_y = x;
+            break;
+        default:
+            *source_x = x;
+            *source_y = y;
+            break;
+    }
+}
+
+// The rect in the stored image's frame that orientation turns into dest about their common centre
+SDL_Rect orientation_stored_rect(const SDL_Rect *dest, int orientation) {
+    SDL_Rect stored = *dest;
+    if (orientation_swaps_axes(orientation)) {
+        stored.w = dest->h;
+        stored.h = dest->w;
+        stored.x = dest->x + (dest->w - stored.w) / 2;
+        stored.y = dest->y + (dest->h - stored.h) / 2;
+    }
+    return stored;
+}
+
+// Maps a screen rect into the stored frame of an image drawn at frame: undoes the turn, then
+// the mirror, about the pivot render_copy_clipped turns around
+SDL_Rect orientation_unmap_rect(const SDL_Rect *rect, const SDL_Rect *frame, int orientation) {
+    if (orientation <= 1 || orientation > 8) {
+        return *rect;
+    }
+
+    int pivot_x = frame->x + frame->w / 2;
+    int pivot_y = frame->y + frame->h / 2;
+    int corners[2][2] = {{rect->x - pivot_x, rect->y - pivot_y},
+                         {rect->x + rect->w - pivot_x, rect->y + rect->h - pivot_y}};
+    double angle = orientation_angle(orientation);
+    SDL_RendererFlip flip = orientation_flip(orientation);
+    for (int i = 0; i < 2; i++) {
+        int x = corners[i][0];
+        int y = corners[i][1];
+        if (angle == 90.0) {
+            corners[i][0] = y;
+            corners[i][1] = -x;
+        } else if (angle == 180.0) {
+            corners[i][0] = -x;
+            corners[i][1] = -y;
+        } else if (angle == 270.0) {
+            corners[i][0] = -y;
+            corners[i][1] = x;
+        }
+        if (flip == SDL_FLIP_HORIZONTAL) {
+            corners[i][0] = -corners[i][0];
+        } else if (flip == SDL_FLIP_VERTICAL) {
+            corners[i][1] = -corners[i][1];
+        }
+    }
+
+    SDL_Rect stored;
+    stored.x = pivot_x + SDL_min(corners[0][0], corners[1][0]);
+    stored.y = pivot_y + SDL_min(corners[0][1], corners[1][1]);
+    stored.w = SDL_abs(corners[1][0] - corners[0][0]);
+    stored.h = SDL_abs(corners[1][1] - corners[0][1]);
+    return stored;
+}
+
+// Copies src onto dest, trimmed to clip on whole texels so the visible pixels land where the
+// unclipped quad would have put them. dest and clip are in the stored frame of the image at
+// frame; any orientation other than 1 is applied to the whole image about frame's centre.
+void render_copy_clipped(SDL_Renderer *renderer, SDL_Texture *texture, const SDL_Rect *src,
+                         const SDL_Rect *dest, const SDL_Rect *clip, const SDL_Rect *frame, int orientation) {
+    SDL_Rect clipped_src = *src;
+    SDL_Rect clipped_dest = *dest;
+    if (clip) {
+        if (src->w <= 0 || src->h <= 0 || dest->w <= 0 || dest->h <= 0) {
+            return;
+        }
+
+        double scale_x = (double)dest->w / src->w;
+        double scale_y = (double)dest->h / src->h;
+        int left = SDL_max(0, (int)((clip->x - dest->x) / scale_x));
+        int top = SDL_max(0, (int)((clip->y - dest->y) / scale_y));
+        int right = SDL_min(src->w, (int)((clip->x + clip->w - dest->x) / scale_x) + 1);
+        int bottom = SDL_min(src->h, (int)((clip->y + clip->h - dest->y) / scale_y) + 1);
+        if (left >= right || top >= bottom) {
+            return;
+        }
+
+        clipped_src.x = src->x + left;
+        clipped_src.y = src->y + top;
+        clipped_src.w = right - left;
+        clipped_src.h = bottom - top;
+        clipped_dest.x = dest->x + (int)(left * scale_x);
+        clipped_dest.y = dest->y + (int)(top * scale_y);
+        clipped_dest.w = dest->x + (int)(right * scale_x) - clipped_dest.x;
+        clipped_dest.h = dest->y + (int)(bottom * scale_y) - clipped_dest.y;
+    }
+
+    if (!frame || orientation <= 1 || orientation > 8) {
+        SDL_RenderCopy(renderer, texture, &clipped_src, &clipped_dest);
+        return;
+    }
+
+    // SDL mirrors each copy within its own rect, so the rect is first mirrored across the frame
+    SDL_RendererFlip flip = orientation_flip(orientation);
+    if (flip == SDL_FLIP_HORIZONTAL) {
+        clipped_dest.x = 2 * frame->x + frame->w - clipped_dest.x - clipped_dest.w;
+    } else if (flip == SDL_FLIP_VERTICAL) {
+        clipped_dest.y = 2 * frame->y + frame->h - clipped_dest.y - clipped_dest.h;
+    }
+    SDL_Point pivot = {frame->x + frame->w / 2 - clipped_dest.x, frame->y + frame->h / 2 - clipped_dest.y};
+    SDL_RenderCopyEx(renderer, texture, &clipped_src, &clipped_dest, orientation_angle(orientation), &pivot, flip);
+}
+
+// Draws the tiles that intersect the viewport, with edges rounded so neighbours share seams.
+// dest_rect is in the stored frame; see orientation_stored_rect.
+void tiled_texture_render(SDL_Renderer *renderer, const TiledTexture *image, const SDL_Rect *dest_rect,
+                          const SDL_Rect *viewport, int nearest, int orientation) {
+    if (!renderer || !image || !image->tiles || !dest_rect || image->width <= 0 || image->height <= 0) {
+        return;
+    }
+
+    double scale_x = (double)dest_rect->w / image->width;
+    double scale_y = (double)dest_rect->h / image->height;
+    SDL_Rect clip = viewport ? orientation_unmap_rect(viewport, dest_rect, orientation) : *dest_rect;
+
+    for (int row = 0; row < image->rows; row++) {
+        int src_y0 = row * image->tile_height;
+        int src_y1 = SDL_min(src_y0 + image->tile_height, image->height);
+        int y0 = dest_rect->y + (int)(src_y0 * scale_y);
+        int y1 = dest_rect->y + (int)(src_y1 * scale_y);
+        if (viewport && (y1 <= clip.y || y0 >= clip.y + clip.h)) {
+            continue;
+        }
+
+        for (int column = 0; column < image->columns; column++) {
+            int src_x0 = column * image->tile_width;
+            int src_x1 = SDL_min(src_x0 + image->tile_width, image->width);
+            int x0 = dest_rect->x + (int)(src_x0 * scale_x);
+            int x1 = dest_rect->x + (int)(src_x1 * scale_x);
+            if (viewport && (x1 <= clip.x || x0 >= clip.x + clip.w)) {
+                continue;
+            }
+
+            SDL_Rect tile_rect = {x0, y0, x1 - x0, y1 - y0};
+            SDL_Rect src = {0, 0, src_x1 - src_x0, src_y1 - src_y0};
+            SDL_Texture *tile = image->tiles[row * image->columns + column];
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+            SDL_SetTextureScaleMode(tile, nearest ? SDL_ScaleModeNearest : SDL_ScaleModeLinear);
+#else
+            (void)nearest;
+#endif
+            render_copy_clipped(renderer, tile, &src, &tile_rect, viewport ? &clip : NULL, dest_rect, orientation);
+        }
+    }
+}
+
+void image_pyramid_destroy(ImagePyramid *image) {
+    if (!image) {
+        return;
+    }
+
+    for (int i = 0; i < image->level_count; i++) {
+        tiled_texture_destroy(&image->levels[i]);
+    }
+    secure_memzero(image, sizeof(ImagePyramid));
+}
+
+// Picks the smallest level that is still at least as large as the area it is drawn into
+const TiledTexture *image_pyramid_level(const ImagePyramid *image, int dest_width, int dest_height) {
+    int level = 0;
+    while (level + 1 < image->level_count &&
+           image->levels[level + 1].width >= dest_width &&
+           image->levels[level + 1].height >= dest_height) {
+        level++;
+    }
+    return &image->levels[level];
+}
+
+// Texture cache functions
+// Returns the newest texture for the path; an older copy may linger while it is on screen
+TextureCacheEntry *texture_cache_find(App *app, const char *image_path) {
+    TextureCacheEntry *found = NULL;
+    for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+        TextureCacheEntry *entry = &app->cache.entries[i];
+        if (entry->image.level_count > 0 && !entry->stale && strcmp(entry->filepath, image_path) == 0 &&
+            (!found || entry->last_used > found->last_used)) {
+            found = entry;
+        }
+    }
+    return found;
+}
+
+void texture_cache_release(TextureCache *cache, TextureCacheEntry *entry) {
+    cache->bytes -= SDL_min(entry->bytes, cache->bytes);
+    image_pyramid_destroy(&entry->image);
+    secure_memzero(entry, sizeof(TextureCacheEntry));
+}
+
+void texture_cache_clear(App *app) {
+    for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+        texture_cache_release(&app->cache, &app->cache.entries[i]);
+    }
+    app->image = NULL;
+}
+
+// Evicts least recently viewed textures until the cache fits the GPU budget; the image on
+// screen and the one just uploaded are kept even when they alone are over
+static void texture_cache_trim(App *app, const TextureCacheEntry *keep) {
+    while (app->cache.bytes > app->memory.gpu_cap) {
+        TextureCacheEntry *victim = NULL;
+        for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+            TextureCacheEntry *entry = &app->cache.entries[i];
+            if (entry->image.level_count == 0 || entry == keep || &entry->image == app->image) {
+                continue;
+            }
+            if (!victim || entry->last_used < victim->last_used) {
+                victim = entry;
+            }
+        }
+        if (!victim) {
+            return;
+        }
+
+        texture_cache_release(&app->cache, victim);
+        app->memory.evictions++;
+    }
+}
+
+// Picks a free slot, otherwise evicts the least recently viewed texture that is not on screen
+static TextureCacheEntry *texture_cache_slot(App *app, const char *image_path) {
+    TextureCacheEntry *victim = texture_cache_find(app, image_path);
+    if (victim && &victim->image != app->image) {
+        return victim;
+    }
+
+    victim = NULL;
+    for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+        TextureCacheEntry *entry = &app->cache.entries[i];
+        if (entry->image.level_count == 0) {
+            return entry;
+        }
+        if (&entry->image == app->image) {
+            continue;
+        }
+        if (!victim || entry->last_used < victim->last_used) {
+            victim = entry;
+        }
+    }
+    return victim;
+}
+
+// Must run on the thread that owns the renderer; the surface stays owned by the caller. A
+// non-zero full size is the image's real size when the levels were already reduced to fit.
+SecurityResult upload_image_surface(App *app, const char *image_path, SDL_Surface **levels, int level_count,
+                                    int full_width, int full_height, const ImageMetadata *metadata,
+                                    TextureCacheEntry **out_entry) {
+    if (!app || !image_path || !levels || level_count < 1 || level_count > MAX_MIP_LEVELS || !out_entry) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    *out_entry = NULL;
+
+    TextureCacheEntry *entry = texture_cache_slot(app, image_path);
+    if (!entry) {
+        return SECURITY_ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Textures of the evicted image are refilled in place when the new one has the same shape
+    ImagePyramid recycled = entry->image;
+    secure_memzero(&entry->image, sizeof(entry->image));
+
+    ImagePyramid image;
+    secure_memzero(&image, sizeof(image));
+    for (int i = 0; i < level_count; i++) {
+        SecurityResult result = tiled_texture_create(app->renderer, levels[i], app->max_texture_width,
+                                                     app->max_texture_height, &app->texture_formats,
+                                                     i < recycled.level_count ? &recycled.levels[i] : NULL,
+                                                     &image.levels[i]);
+        if (result != SECURITY_OK) {
+            image_pyramid_destroy(&image);
+            image_pyramid_destroy(&recycled);
+            texture_cache_release(&app->cache, entry);
+            return result;
+        }
+        image.level_count++;
+    }
+    image.width = full_width > 0 ? full_width : levels[0]->w;
+    image.height = full_height > 0 ? full_height : levels[0]->h;
+    image_pyramid_destroy(&recycled);
+
+    size_t bytes = 0;
+    for (int i = 0; i < level_count; i++) {
+        Uint32 format = choose_texture_format(&app->texture_formats, levels[i]);
+        int pixel_bytes = format != SDL_PIXELFORMAT_UNKNOWN ? SDL_BYTESPERPIXEL(format) : 4;
+        bytes += (size_t)levels[i]->w * (size_t)levels[i]->h * (size_t)pixel_bytes;
+    }
+
+    texture_cache_release(&app->cache, entry);
+    secure_strncpy(entry->filepath, image_path, sizeof(entry->filepath));
+    entry->image = image;
+    entry->bytes = bytes;
+    app->cache.bytes += bytes;
+    entry->last_used = ++app->cache.clock;
+    if (metadata) {
+        entry->metadata = *metadata;
+    }
+    if (entry->metadata.width == 0 || entry->metadata.height == 0) {
+        // Header format not recognized; reuse what the decoder already reported
+        entry->metadata.width = image.width;
+        entry->metadata.height = image.height;
+    }
+
+    texture_cache_trim(app, entry);
+    *out_entry = entry;
+    return SECURITY_OK;
+}
+
+void show_cache_entry(App *app, TextureCacheEntry *entry) {
+    // Out-of-date versions of files are only kept while they are on screen
+    for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+        TextureCacheEntry *other = &app->cache.entries[i];
+        if (other->stale && other != entry) {
+            if (&other->image == app->image) {
+                app->image = NULL;
+            }
+            texture_cache_release(&app->cache, other);
+        }
+    }
+
+    app->image = &entry->image;
+    app->image_width = entry->image.width;
+    app->image_height = entry->image.height;
+    app->image_orientation = entry->metadata.orientation;
+    app->metadata = entry->metadata;
+    app->metadata_version++;
+    app->image_reduced = entry->reduced;
+    app->upgrade_requested = 0;
+    entry->last_used = ++app->cache.clock;
+    app->needs_redraw = 1;
+}
+
+SecurityResult load_image_secure(App *app, const char *image_path) {
+    if (!app || !image_path) {
+        return SECURITY_ERROR_INVALID_INPUT;
+    }
+
+    SDL_Surface *levels[MAX_MIP_LEVELS] = {0};
+    SecurityResult result = decode_image_secure(image_path, &app->decode_workers, &app->pixel_pool, &levels[0]);
+    if (result != SECURITY_OK) {
+        return result;
+    }
+
+    int level_count = build_mip_levels(&app->pixel_pool, levels, MAX_MIP_LEVELS);
+    TextureCacheEntry *entry = NULL;
+    result = upload_image_surface(app, image_path, levels, level_count, 0, 0, NULL, &entry);
+    if (result == SECURITY_OK) {
+        secure_strncpy(app->current_path, image_path, sizeof(app->current_path));
+        show_cache_entry(app, entry);
+    }
+    free_surface_levels(levels, level_count);
+    return result;
+}
+
+int report_load_result(const App *app, const char *image_path, SecurityResult result) {
+    switch (result) {
+        case SECURITY_OK:
+            SDL_Log("Loaded image: %s (%dx%d)", image_path, app->image_width, app->image_height);
+            return 1;
+        case SECURITY_ERROR_INVALID_INPUT:
+            SDL_Log("Security error: Invalid input parameters");
+            return 0;
+        case SECURITY_ERROR_PATH_TOO_LONG:
+            SDL_Log("Security error: File path too long");
+            return 0;
+        case SECURITY_ERROR_FILE_TOO_LARGE:
+            SDL_Log("Security error: File size exceeds limit");
+            return 0;
+        case SECURITY_ERROR_ACCESS_DENIED:
+            SDL_Log("Security error: Access denied or file not found");
+            return 0;
+        case SECURITY_ERROR_MEMORY_ALLOCATION:
+            SDL_Log("Security error: Memory allocation failed");
+            return 0;
+        default:
+            SDL_Log("Security error: Unknown error occurred");
+            return 0;
+    }
+}
+
+// Color management functions
+// EXIF and ICC readers come first: both are plain bounds-checked walks over the mapped file.
+static Uint16 exif_u16(const ExifReader *exif, size_t offset) {
+    if (offset > exif->size || exif->size - offset < 2) {
+        return 0;
+    }
+    const Uint8 *p = exif->data + offset;
+    return exif->big_endian ? read_be16(p) : read_le16(p);
+}
+
+static Uint32 exif_u32(const ExifReader *exif, size_t offset) {
+    if (offset > exif->size || exif->size - offset < 4) {
+        return 0;
+    }
+    const Uint8 *p = exif->data + offset;
+    return exif->big_endian ? read_be32(p) : read_le32(p);
+}
+
+// Steps through the marker segments ahead of the first scan; *position starts just after SOI
+static int jpeg_next_segment(const Uint8 *data, size_t size, size_t *position, Uint8 *marker,
+                             const Uint8 **payload, size_t *length) {
+    size_t pos = *position;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return 0;
+        }
+        Uint8 type = data[pos + 1];
+        if (type == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (type == 0xDA || type == 0xD9) {
+            return 0;
+        }
+        if (type == 0x01 || type == 0xD8 || (type >= 0xD0 && type <= 0xD7)) {
+            pos += 2;
+            continue;
+        }
+        size_t segment = read_be16(data + pos + 2);
+        if (segment < 2 || segment > size - pos - 2) {
+            return 0;
+        }
+        *marker = type;
+        *payload = data + pos + 4;
+        *length = segment - 2;
+        *position = pos + 2 + segment;
+        return 1;
+    }
+    return 0;
+}
+
+// Points exif at the TIFF header of a JPEG's APP1 Exif segment; returns 0 when there is none
+int exif_open_jpeg(const Uint8 *data, size_t size, ExifReader *exif) {
+    if (!data || size < 4 || data[0] != 0xFF || data[1] != 0xD8 || !exif) {
+        return 0;
+    }
+
+    size_t position = 2;
+    Uint8 marker = 0;
+    const Uint8 *payload = NULL;
+    size_t length = 0;
+    while (jpeg_next_segment(data, size, &position, &marker, &payload, &length)) {
+        if (marker != 0xE1 || length < 14 || memcmp(payload, "Exif\0\0", 6) != 0) {
+            continue;
+        }
+        exif->data = payload + 6;
+        exif->size = length - 6;
+        if (memcmp(exif->data, "II", 2) == 0) {
+            exif->big_endian = 0;
+        } else if (memcmp(exif->data, "MM", 2) == 0) {
+            exif->big_endian = 1;
+        } else {
+            return 0;
+        }
+        return exif_u16(exif, 2) == 42;
+    }
+    return 0;
+}
+
+size_t exif_first_ifd(const ExifReader *exif) {
+    return exif_u32(exif, 4);
+}
+
+// Offset of the 12-byte entry for tag in the IFD at ifd, or 0 when it is absent
+size_t exif_find_entry(const ExifReader *exif, size_t ifd, Uint16 tag) {
+    if (ifd < 8) {
+        return 0;
+    }
+    Uint16 count = exif_u16(exif, ifd);
+    for (Uint16 i = 0; i < count; i++) {
+        size_t entry = ifd + 2 + (size_t)i * 12;
+        if (entry + 12 > exif->size) {
+            return 0;
+        }
+        if (exif_u16(exif, entry) == tag) {
+            return entry;
+        }
+    }
+    return 0;
+}
+
+// Inline value of a SHORT or LONG entry; other types read as 0
+Uint32 exif_entry_value(const ExifReader *exif, size_t entry) {
+    if (!entry) {
+        return 0;
+    }
+    Uint16 type = exif_u16(exif, entry + 2);
+    return type == 3 ? exif_u16(exif, entry + 8) : type == 4 ? exif_u32(exif, entry + 8) : 0;
+}
+
+// Copies an ASCII entry, which is stored inline when it fits in four bytes
+int exif_entry_string(const ExifReader *exif, size_t entry, char *out, size_t out_size) {
+    if (!entry || out_size == 0 || exif_u16(exif, entry + 2) != 2) {
+        return 0;
+    }
+    Uint32 count = exif_u32(exif, entry + 4);
+    size_t offset = count <= 4 ? entry + 8 : exif_u32(exif, entry + 8);
+    if (count == 0 || offset > exif->size || count > exif->size - offset) {
+        return 0;
+    }
+
+    size_t length = 0;
+    while (length < count && length + 1 < out_size && exif->data[offset + length]) {
+        Uint8 c = exif->data[offset + length];
+        out[length++] = (c >= 0x20 && c < 0x7F) ? (char)c : '?';
+    }
+    // Makers pad with spaces to a fixed width
+    while (length > 0 && out[length - 1] == ' ') {
+        length--;
+    }
+    out[length] = '\0';
+    return length > 0;
+}
+
+// EXIF ColorSpace is 1 for sRGB and 0xFFFF otherwise; DCF marks Adobe RGB files by also
+// setting the interoperability index to "R03"
+static const char *exif_color_space(const ExifReader *exif) {
+    size_t exif_ifd = exif_entry_value(exif, exif_find_entry(exif, exif_first_ifd(exif), 0x8769));
+    size_t entry = exif_find_entry(exif, exif_ifd, 0xA001);
+    if (!entry) {
+        return NULL;
+    }
+    Uint32 space = exif_entry_value(exif, entry);
+    if (space == 1) {
+        return "sRGB";
+    }
+    if (space != 0xFFFF) {
+        return NULL;
+    }
+
+    size_t interop = exif_entry_value(exif, exif_find_entry(exif, exif_ifd, 0xA005));
+    size_t index = exif_find_entry(exif, interop, 0x0001);
+    if (index && exif_u32(exif, index + 4) == 4 && memcmp(exif->data + index + 8, "R03", 3) == 0) {
+        return "Adobe RGB";
+    }
+    return "Uncalibrated";
+}
+
+// Reassembles the APP2 ICC_PROFILE chunks of a JPEG, which may arrive in any order
+static Uint8 *jpeg_read_icc(const Uint8 *data, size_t size, size_t *out_size) {
+    static const char signature[] = "ICC_PROFILE";
+    size_t chunk_sizes[256] = {0};
+    const Uint8 *chunks[256] = {0};
+    int chunk_count = 0;
+
+    size_t position = 2;
+    Uint8 marker = 0;
+    const Uint8 *payload = NULL;
+    size_t length = 0;
+    while (jpeg_next_segment(data, size, &position, &marker, &payload, &length)) {
+        if (marker != 0xE2 || length <= sizeof(signature) + 2 || memcmp(payload, signature, sizeof(signature)) != 0) {
+            continue;
+        }
+        int sequence = payload[sizeof(signature)];
+        int count = payload[sizeof(signature) + 1];
+        if (sequence == 0 || sequence > count || (chunk_count && count != chunk_count) || chunks[sequence]) {
+            return NULL;
+        }
+        chunk_count = count;
+        chunks[sequence] = payload + sizeof(signature) + 2;
+        chunk_sizes[sequence] = length - sizeof(signature) - 2;
+    }
+
+    size_t total = 0;
+    for (int i = 1; i <= chunk_count; i++) {
+        if (!chunks[i]) {
+            return NULL;
+        }
+        total += chunk_sizes[i];
+    }
+
+    Uint8 *icc = NULL;
+    if (total == 0 || total > COLOR_MAX_PROFILE_BYTES ||
+        safe_malloc_uninitialized((void **)&icc, total) != SECURITY_OK) {
+        return NULL;
+    }
+    size_t offset = 0;
+    for (int i = 1; i <= chunk_count; i++) {
+        memcpy(icc + offset, chunks[i], chunk_sizes[i]);
+        offset += chunk_sizes[i];
+    }
+    *out_size = total;
+    return icc;
+}
+
+#ifdef PHOTON_STREAMING_DECODE
+// iCCP is zlib-compressed; libpng already links zlib, so it does the inflating
+static Uint8 *png_read_icc(const Uint8 *data, size_t size, size_t *out_size) {
+    PngMemoryReader reader = {data, size, 0};
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, png_error_escape, png_warning_silent);
+    if (!png) {
+        return NULL;
+    }
+    png_infop info = png_create_info_struct(png);
+    if (!info) {
+        png_destroy_read_struct(&png, NULL, NULL);
+        return NULL;
+    }
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, NULL);
+        return NULL;
+    }
+
+    png_set_read_fn(png, &reader, png_read_memory);
+    png_read_info(png, info);
+
+    png_charp name = NULL;
+    int compression = 0;
+    png_bytep profile = NULL;
+    png_uint_32 length = 0;
+    Uint8 *icc = NULL;
+    if (png_get_iCCP(png, info, &name, &compression, &profile, &length) && length > 0 &&
+        length <= COLOR_MAX_PROFILE_BYTES && safe_malloc_uninitialized((void **)&icc, length) == SECURITY_OK) {
+        memcpy(icc, profile, length);
+        *out_size = length;
+    }
+    png_destroy_read_struct(&png, &info, NULL);
+    return icc;
+}
+#endif
+
+static float icc_s15f16(const Uint8 *p) {
+    return (float)(Sint32)read_be32(p) / 65536.0f;
+}
+
+// Data of the tag with the given signature, bounds-checked against the profile
+static const Uint8 *icc_find_tag(const Uint8 *icc, size_t size, const char *signature, size_t *length) {
+    if (size < 132) {
+        return NULL;
+    }
+    Uint32 count = read_be32(icc + 128);
+    for (Uint32 i = 0; i < count && 132 + ((size_t)i + 1) * 12 <= size; i++) {
+        const Uint8 *entry = icc + 132 + (size_t)i * 12;
+        Uint32 offset = read_be32(entry + 4);
+        Uint32 tag_size = read_be32(entry + 8);
+        if (memcmp(entry, signature, 4) == 0 && offset <= size && tag_size <= size - offset) {
+            *length = tag_size;
+            return icc + offset;
+        }
+    }
+    return NULL;
+}
+
+// ICC parametric curve types 0-4; params holds g, a, b, c, d, e, f as far as the type uses them
+static void color_sample_parametric(float *table, int type, const float *params) {
+    float g = params[0], a = params[1], b = params[2], c = params[3], d = params[4], e = params[5], f = params[6];
+    for (int i = 0; i < COLOR_CURVE_SIZE; i++) {
+        float x = (float)i / (COLOR_CURVE_SIZE - 1);
+        float y;
+        if (type == 0) {
+            y = (float)SDL_pow(x, g);
+        } else if (type == 1 || type == 2) {
+            float base = a * x + b;
+            y = (a != 0.0f && x >= -b / a && base > 0.0f) ? (float)SDL_pow(base, g) : 0.0f;
+            y += type == 2 ? c : 0.0f;
+        } else {
+            float base = a * x + b;
+            y = x >= d ? (base > 0.0f ? (float)SDL_pow(base, g) : 0.0f) + e : c * x + f;
+        }
+        table[i] = SDL_max(0.0f, SDL_min(y, 1.0f));
+    }
+}
+
+// Samples a curv or para tone curve into table; returns 0 for anything else
+static int icc_read_curve(const Uint8 *tag, size_t length, float *table) {
+    if (length >= 12 && memcmp(tag, "curv", 4) == 0) {
+        Uint32 count = read_be32(tag + 8);
+        if (count <= 1) {
+            float params[7] = {1.0f};
+            if (count == 1) {
+                if (length < 14) {
+                    return 0;
+                }
+                params[0] = read_be16(tag + 12) / 256.0f;
+            }
+            color_sample_parametric(table, 0, params);
+            return 1;
+        }
+        if (count > (length - 12) / 2) {
+            return 0;
+        }
+        for (int i = 0; i < COLOR_CURVE_SIZE; i++) {
+            float pos = (float)i * (count - 1) / (COLOR_CURVE_SIZE - 1);
+            Uint32 j = SDL_min((Uint32)pos, count - 2);
+            float a = read_be16(tag + 12 + j * 2) / 65535.0f;
+            float b = read_be16(tag + 14 + j * 2) / 65535.0f;
+            table[i] = a + (b - a) * (pos - (float)j);
+        }
+        return 1;
+    }
+
+    if (length >= 12 && memcmp(tag, "para", 4) == 0) {
+        static const int param_counts[5] = {1, 3, 4, 5, 7};
+        int type = read_be16(tag + 8);
+        if (type > 4 || length < 12 + (size_t)param_counts[type] * 4) {
+            return 0;
+        }
+        float params[7] = {0};
+        for (int i = 0; i < param_counts[type]; i++) {
+            params[i] = icc_s15f16(tag + 12 + i * 4);
+        }
+        // Type 3 has no e/f offsets; evaluate it as type 4 with both zero
+        color_sample_parametric(table, type == 3 ? 4 : type, params);
+        return 1;
+    }
+    return 0;
+}
+
+// Profile description from a v2 desc or v4 mluc tag, reduced to printable ASCII
+static void icc_read_description(const Uint8 *icc, size_t size, char *out, size_t out_size) {
+    size_t length = 0;
+    const Uint8 *tag = icc_find_tag(icc, size, "desc", &length);
+    size_t pos = 0;
+    if (tag && length >= 12 && memcmp(tag, "desc", 4) == 0) {
+        Uint32 count = read_be32(tag + 8);
+        for (Uint32 i = 0; i < count && 12 + i < length && pos + 1 < out_size && tag[12 + i]; i++) {
+            out[pos++] = (tag[12 + i] >= 0x20 && tag[12 + i] < 0x7F) ? (char)tag[12 + i] : '?';
+        }
+    } else if (tag && length >= 28 && memcmp(tag, "mluc", 4) == 0 && read_be32(tag + 8) > 0) {
+        // First record only; which language it is does not matter for a label
+        Uint32 text_length = read_be32(tag + 20);
+        Uint32 offset = read_be32(tag + 24);
+        for (Uint32 i = 0; offset <= length && i + 1 < text_length && i + 1 < length - offset &&
+                           pos + 1 < out_size; i += 2) {
+            Uint16 unit = read_be16(tag + offset + i);
+            if (unit == 0) {
+                break;
+            }
+            out[pos++] = (unit >= 0x20 && unit < 0x7F) ? (char)unit : '?';
+        }
+    }
+    if (out_size > 0) {
+        out[pos] = '\0';
+    }
+}
+
+// Matrix/TRC RGB profiles only; LUT-based ones are reported by name but left unmanaged
+int color_profile_parse(const Uint8 *icc, size_t size, ColorProfile *profile) {
+    static const char *columns[3] = {"rXYZ", "gXYZ", "bXYZ"};
+    static const char *curves[3] = {"rTRC", "gTRC", "bTRC"};
+    if (!icc || size < 132 || read_be32(icc) > size || memcmp(icc + 36, "acsp", 4) != 0 ||
+        memcmp(icc + 16, "RGB ", 4) != 0 || memcmp(icc + 20, "XYZ ", 4) != 0) {
+        return 0;
+    }
+
+    for (int c = 0; c < 3; c++) {
+        size_t length = 0;
+        const Uint8 *tag = icc_find_tag(icc, size, columns[c], &length);
+        if (!tag || length < 20 || memcmp(tag, "XYZ ", 4) != 0) {
+            return 0;
+        }
+        for (int row = 0; row < 3; row++) {
+            profile->to_xyz[row][c] = icc_s15f16(tag + 8 + row * 4);
+        }
+        tag = icc_find_tag(icc, size, curves[c], &length);
+        if (!tag || !icc_read_curve(tag, length, profile->curves[c])) {
+            return 0;
+        }
+    }
+
+    // FNV-1a; the top bit keeps it clear of the built-in profile ids
+    Uint32 hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ icc[i]) * 16777619u;
+    }
+    profile->id = hash | 0x80000000u;
+    return 1;
+}
+
+// Built-in profiles, D50-adapted like ICC primaries: 1 is sRGB, 2 is Adobe RGB (1998)
+void color_profile_builtin(ColorProfile *profile, int id) {
+    static const float srgb[3][3] = {
+        {0.4360747f, 0.3850649f, 0.1430804f},
+        {0.2225045f, 0.7168786f, 0.0606169f},
+        {0.0139322f, 0.0971045f, 0.7141733f},
+    };
+    static const float adobe[3][3] = {
+        {0.6097559f, 0.2052401f, 0.1492240f},
+        {0.3111242f, 0.6256560f, 0.0632197f},
+        {0.0194811f, 0.0608902f, 0.7448387f},
+    };
+    static const float srgb_curve[7] = {2.4f, 1.0f / 1.055f, 0.055f / 1.055f, 1.0f / 12.92f, 0.04045f, 0.0f, 0.0f};
+    static const float adobe_curve[7] = {2.19921875f};
+
+    profile->id = (Uint32)id;
+    memcpy(profile->to_xyz, id == 2 ? adobe : srgb, sizeof(profile->to_xyz));
+    for (int c = 0; c < 3; c++) {
+        color_sample_parametric(profile->curves[c], id == 2 ? 0 : 4, id == 2 ? adobe_curve : srgb_curve);
+    }
+}
+
+// Names the color space of a JPEG or PNG: an embedded ICC profile wins over EXIF (JPEG) or the
+// sRGB chunk (PNG). name may be NULL. Returns 1 and fills profile when the pixels need converting
+// from something other than sRGB; untagged images are taken to be sRGB.
+int color_space_detect(const Uint8 *data, size_t size, char *name, size_t name_size, ColorProfile *profile) {
+    char label[48] = "";
+    Uint8 *icc = NULL;
+    size_t icc_size = 0;
+    int builtin = 0;
+
+    if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8) {
+        icc = jpeg_read_icc(data, size, &icc_size);
+        ExifReader exif;
+        const char *space = (!icc && exif_open_jpeg(data, size, &exif)) ? exif_color_space(&exif) : NULL;
+        if (space) {
+            secure_strncpy(label, space, sizeof(label));
+            builtin = strcmp(space, "Adobe RGB") == 0 ? 2 : 0;
+        }
+    } else if (size >= 8 && memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0) {
+        for (size_t pos = 8; pos + 12 <= size;) {
+            Uint32 length = read_be32(data + pos);
+            const Uint8 *type = data + pos + 4;
+            if (length > size - pos - 12 || memcmp(type, "IDAT", 4) == 0) {
+                break;
+            }
+            if (memcmp(type, "sRGB", 4) == 0 && !label[0]) {
+                secure_strncpy(label, "sRGB", sizeof(label));
+            } else if (memcmp(type, "iCCP", 4) == 0) {
+#ifdef PHOTON_STREAMING_DECODE
+                icc = png_read_icc(data, size, &icc_size);
+#endif
+                // The keyword names the profile until the profile's own description is read
+                size_t keyword = 0;
+                while (keyword < length && keyword + 1 < sizeof(label) && data[pos + 8 + keyword]) {
+                    label[keyword] = (char)data[pos + 8 + keyword];
+                    keyword++;
+                }
+                label[keyword] = '\0';
+                break;
+            }
+            pos += 12 + (size_t)length;
+        }
+    }
+
+    int managed = 0;
+    if (icc) {
+        char description[48];
+        icc_read_description(icc, icc_size, description, sizeof(description));
+        if (description[0]) {
+            memcpy(label, description, sizeof(label));
+        } else if (!label[0]) {
+            secure_strncpy(label, "ICC profile", sizeof(label));
+        }
+        managed = profile && color_profile_parse(icc, icc_size, profile);
+        safe_free((void **)&icc);
+    } else if (builtin && profile) {
+        color_profile_builtin(profile, builtin);
+        managed = 1;
+    }
+
+    if (name && name_size > 0) {
+        secure_strncpy(name, label, name_size);
+    }
+    return managed;
+}
+
+int color_manager_init(ColorManager *color) {
+    secure_memzero(color, sizeof(ColorManager));
+    color->lock = SDL_CreateMutex();
+    if (!color->lock) {
+        SDL_Log("Failed to create color lock: %s", SDL_GetError());
+        return 0;
+    }
+    color_profile_builtin(&color->display, 1);
+    secure_strncpy(color->display_name, "sRGB", sizeof(color->display_name));
+    return 1;
+}
+
+void color_manager_destroy(ColorManager *color) {
+    if (!color) {
+        return;
+    }
+    for (int i = 0; i < COLOR_LUT_CACHE; i++) {
+        safe_free((void **)&color->luts[i].nodes);
+    }
+    if (color->lock) {
+        SDL_DestroyMutex(color->lock);
+        color->lock = NULL;
+    }
+}
+
+// Reads the profile of the display the window is on; sRGB when it has none we can use
+void color_manager_update_display(ColorManager *color, SDL_Window *window) {
+    if (!color || !color->lock) {
+        return;
+    }
+
+    ColorProfile display;
+    char name[48] = "";
+    int found = 0;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    size_t size = 0;
+    Uint8 *icc = window ? (Uint8 *)SDL_GetWindowICCProfile(window, &size) : NULL;
+    if (icc) {
+        found = color_profile_parse(icc, size, &display);
+        if (found) {
+            icc_read_description(icc, size, name, sizeof(name));
+        }
+        SDL_free(icc);
+    }
+#else
+    (void)window;
+#endif
+    if (!found) {
+        color_profile_builtin(&display, 1);
+        secure_strncpy(name, "sRGB", sizeof(name));
+    }
+
+    SDL_LockMutex(color->lock);
+    int changed = color->display.id != display.id;
+    color->display = display;
+    if (name[0]) {
+        memcpy(color->display_name, name, sizeof(color->display_name));
+    } else {
+        secure_strncpy(color->display_name, "ICC profile", sizeof(color->display_name));
+    }
+    SDL_UnlockMutex(color->lock);
+
+    if (changed) {
+        SDL_Log("Display color profile: %s", color->display_name);
+    }
+}
+
+static float color_curve_eval(const float *table, float x) {
+    float pos = SDL_max(0.0f, SDL_min(x, 1.0f)) * (COLOR_CURVE_SIZE - 1);
+    int i = SDL_min((int)pos, COLOR_CURVE_SIZE - 2);
+    return table[i] + (table[i + 1] - table[i]) * (pos - (float)i);
+}
+
+// Tone curves are non-decreasing, so the inverse is a binary search plus a lerp
+static float color_curve_invert(const float *table, float y) {
+    if (y <= table[0]) {
+        return 0.0f;
+    }
+    if (y >= table[COLOR_CURVE_SIZE - 1]) {
+        return 1.0f;
+    }
+    int low = 0;
+    int high = COLOR_CURVE_SIZE - 1;
+    while (high - low > 1) {
+        int mid = (low + high) / 2;
+        if (table[mid] <= y) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    float span = table[high] - table[low];
+    float t = span > 0.0f ? (y - table[low]) / span : 0.0f;
+    return ((float)low + t) / (COLOR_CURVE_SIZE - 1);
+}
+
+static int color_invert_matrix(const float m[3][3], float out[3][3]) {
+    float det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+                m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+                m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+    if (SDL_fabs(det) < 1e-8) {
+        return 0;
+    }
+    float inv = 1.0f / det;
+    out[0][0] = (m[1][1] * m[2][2] - m[1][2] * m[2][1]) * inv;
+    out[0][1] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * inv;
+    out[0][2] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * inv;
+    out[1][0] = (m[1][2] * m[2][0] - m[1][0] * m[2][2]) * inv;
+    out[1][1] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * inv;
+    out[1][2] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * inv;
+    out[2][0] = (m[1][0] * m[2][1] - m[1][1] * m[2][0]) * inv;
+    out[2][1] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * inv;
+    out[2][2] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * inv;
+    return 1;
+}
+
+// Samples source curves -> XYZ -> display primaries -> display curves at every grid node
+static int color_lut_build(ColorLut *lut, const ColorProfile *source, const ColorProfile *display) {
+    const int n = COLOR_LUT_SIZE;
+    float from_xyz[3][3];
+    if (!color_invert_matrix(display->to_xyz, from_xyz)) {
+        return 0;
+    }
+    float m[3][3];
+    for (int row = 0; row < 3; row++) {
+        for (int c = 0; c < 3; c++) {
+            m[row][c] = from_xyz[row][0] * source->to_xyz[0][c] + from_xyz[row][1] * source->to_xyz[1][c] +
+                        from_xyz[row][2] * source->to_xyz[2][c];
+        }
+    }
+
+    if (!lut->nodes &&
+        safe_malloc_uninitialized((void **)&lut->nodes, (size_t)n * n * n * 4 * sizeof(float)) != SECURITY_OK) {
+        return 0;
+    }
+
+    float max_error = 0.0f;
+    float *node = lut->nodes;
+    for (int r = 0; r < n; r++) {
+        for (int g = 0; g < n; g++) {
+            for (int b = 0; b < n; b++, node += 4) {
+                float in[3] = {(float)r / (n - 1), (float)g / (n - 1), (float)b / (n - 1)};
+                float linear[3];
+                for (int c = 0; c < 3; c++) {
+                    linear[c] = color_curve_eval(source->curves[c], in[c]);
+                }
+                for (int c = 0; c < 3; c++) {
+                    float value = m[c][0] * linear[0] + m[c][1] * linear[1] + m[c][2] * linear[2];
+                    node[c] = color_curve_invert(display->curves[c], value);
+                    max_error = SDL_max(max_error, (float)SDL_fabs(node[c] - in[c]));
+                }
+                node[3] = 0.0f;
+            }
+        }
+    }
+
+    lut->source_id = source->id;
+    lut->display_id = display->id;
+    lut->identity = max_error < 0.5f / 255.0f;
+    return 1;
+}
+
+// LUT from source to the current display, built on first use and cached per profile pair.
+// NULL when no conversion is needed. Only the loader thread builds or reuses LUTs, so the
+// returned one stays valid until its next call.
+static const ColorLut *color_manager_lut(ColorManager *color, const ColorProfile *source) {
+    if (!color || !color->lock) {
+        return NULL;
+    }
+
+    SDL_LockMutex(color->lock);
+    color->clock++;
+    ColorLut *slot = &color->luts[0];
+    for (int i = 0; i < COLOR_LUT_CACHE; i++) {
+        ColorLut *lut = &color->luts[i];
+        if (lut->nodes && lut->source_id == source->id && lut->display_id == color->display.id) {
+            lut->last_used = color->clock;
+            SDL_UnlockMutex(color->lock);
+            return lut->identity ? NULL : lut;
+        }
+        if (!lut->nodes || (slot->nodes && lut->last_used < slot->last_used)) {
+            slot = lut;
+        }
+    }
+
+    ColorLut *result = NULL;
+    if (color_lut_build(slot, source, &color->display)) {
+        slot->last_used = color->clock;
+        result = slot->identity ? NULL : slot;
+    } else {
+        safe_free((void **)&slot->nodes);
+    }
+    SDL_UnlockMutex(color->lock);
+    return result;
+}
+
+// Trilinear interpolation between the eight nodes around a pixel; the AVX2 kernel below does
+// the same float operations in the same order, so both produce identical bytes
+static void color_transform_row_scalar(const float *nodes, Uint8 *row, int width, int bpp, const int *offsets) {
+    const float scale = (COLOR_LUT_SIZE - 1) / 255.0f;
+    for (int x = 0; x < width; x++, row += bpp) {
+        int index[3];
+        float t[3];
+        for (int c = 0; c < 3; c++) {
+            float pos = (float)row[offsets[c]] * scale;
+            index[c] = SDL_min((int)pos, COLOR_LUT_SIZE - 2);
+            t[c] = pos - (float)index[c];
+        }
+        const float *base = nodes + index[0] * COLOR_NODE_R + index[1] * COLOR_NODE_G + index[2] * COLOR_NODE_B;
+        for (int c = 0; c < 3; c++) {
+            const float *v = base + c;
+            float c00 = v[0] + (v[COLOR_NODE_B] - v[0]) * t[2];
+            float c01 = v[COLOR_NODE_G] + (v[COLOR_NODE_G + COLOR_NODE_B] - v[COLOR_NODE_G]) * t[2];
+            float c10 = v[COLOR_NODE_R] + (v[COLOR_NODE_R + COLOR_NODE_B] - v[COLOR_NODE_R]) * t[2];
+            float c11 = v[COLOR_NODE_R + COLOR_NODE_G] +
+                        (v[COLOR_NODE_R + COLOR_NODE_G + COLOR_NODE_B] - v[COLOR_NODE_R + COLOR_NODE_G]) * t[2];
+            float c0 = c00 + (c01 - c00) * t[1];
+            float c1 = c10 + (c11 - c10) * t[1];
+            float value = c0 + (c1 - c0) * t[0];
+            value = SDL_max(0.0f, SDL_min(value, 1.0f));
+            row[offsets[c]] = (Uint8)(int)(value * 255.0f + 0.5f);
+        }
+    }
+}
+
+#ifdef PHOTON_X86_KERNELS
+__attribute__((target("avx2"))) static __m256 color_lerp_avx2(__m256 a, __m256 b, __m256 t) {
+    return _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), t));
+}
+
+// Eight pixels per step. Each pixel's 32-bit word is gathered from x * bpp, so RGB24 rows stop
+// one pixel early to keep the last gather inside the row; the scalar loop finishes them.
+__attribute__((target("avx2"))) static void color_transform_row_avx2(const float *nodes, Uint8 *row, int width,
+                                                                    int bpp, const int *offsets) {
+    const __m256 scale = _mm256_set1_ps((COLOR_LUT_SIZE - 1) / 255.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 max_byte = _mm256_set1_ps(255.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256i last = _mm256_set1_epi32(COLOR_LUT_SIZE - 2);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i lanes = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(bpp));
+    const int corners[8] = {0, COLOR_NODE_B, COLOR_NODE_G, COLOR_NODE_G + COLOR_NODE_B, COLOR_NODE_R,
+                            COLOR_NODE_R + COLOR_NODE_B, COLOR_NODE_R + COLOR_NODE_G,
+                            COLOR_NODE_R + COLOR_NODE_G + COLOR_NODE_B};
+    __m256i keep = _mm256_set1_epi32(-1);
+    for (int c = 0; c < 3; c++) {
+        keep = _mm256_andnot_si256(_mm256_sll_epi32(byte_mask, _mm_cvtsi32_si128(offsets[c] * 8)), keep);
+    }
+
+    int x = 0;
+    int limit = bpp == 4 ? width - 8 : width - 9;
+    for (; x <= limit; x += 8) {
+        Uint8 *p = row + (size_t)x * bpp;
+        __m256i words = _mm256_i32gather_epi32((const int *)p, lanes, 1);
+        __m256i index[3];
+        __m256 t[3];
+        for (int c = 0; c < 3; c++) {
+            __m256i value = _mm256_and_si256(_mm256_srl_epi32(words, _mm_cvtsi32_si128(offsets[c] * 8)), byte_mask);
+            __m256 pos = _mm256_mul_ps(_mm256_cvtepi32_ps(value), scale);
+            index[c] = _mm256_min_epi32(_mm256_cvttps_epi32(pos), last);
+            t[c] = _mm256_sub_ps(pos, _mm256_cvtepi32_ps(index[c]));
+        }
+        __m256i base = _mm256_add_epi32(_mm256_add_epi32(
+                           _mm256_mullo_epi32(index[0], _mm256_set1_epi32(COLOR_NODE_R)),
+                           _mm256_mullo_epi32(index[1], _mm256_set1_epi32(COLOR_NODE_G))),
+                           _mm256_slli_epi32(index[2], 2));
+
+        __m256i out = _mm256_and_si256(words, keep);
+        for (int c = 0; c < 3; c++) {
+            __m256 v[8];
+            for (int k = 0; k < 8; k++) {
+                v[k] = _mm256_i32gather_ps(nodes + c + corners[k], base, 4);
+            }
+            __m256 c00 = color_lerp_avx2(v[0], v[1], t[2]);
+            __m256 c01 = color_lerp_avx2(v[2], v[3], t[2]);
+            __m256 c10 = color_lerp_avx2(v[4], v[5], t[2]);
+            __m256 c11 = color_lerp_avx2(v[6], v[7], t[2]);
+            __m256 c0 = color_lerp_avx2(c00, c01, t[1]);
+            __m256 c1 = color_lerp_avx2(c10, c11, t[1]);
+            __m256 value = _mm256_max_ps(zero, _mm256_min_ps(color_lerp_avx2(c0, c1, t[0]), one));
+            __m256i code = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, max_byte), half));
+            out = _mm256_or_si256(out, _mm256_sll_epi32(code, _mm_cvtsi32_si128(offsets[c] * 8)));
+        }
+
+        if (bpp == 4) {
+            _mm256_storeu_si256((__m256i *)p, out);
+        } else {
+            // Drop the fourth byte of each word, leaving 12 packed bytes per 128-bit lane
+            const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                                  0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+            Uint8 packed[32];
+            _mm256_storeu_si256((__m256i *)packed, _mm256_shuffle_epi8(out, pack));
+            memcpy(p, packed, 12);
+            memcpy(p + 12, packed + 16, 12);
+        }
+    }
+    color_transform_row_scalar(nodes, row + (size_t)x * bpp, width - x, bpp, offsets);
+}
+#endif
+
+typedef void (*ColorRowKernel)(const float *nodes, Uint8 *row, int width, int bpp, const int *offsets);
+
+typedef struct {
+    const ColorLut *lut;
+    SDL_Surface *surface;
+    ColorRowKernel kernel;
+    int offsets[3];
+    int band_count;
+} ColorTransformJob;
+
+static void color_transform_band(void *context, int index) {
+    ColorTransformJob *job = (ColorTransformJob *)context;
+    SDL_Surface *surface = job->surface;
+    int first = (int)((long long)surface->h * index / job->band_count);
+    int end = (int)((long long)surface->h * (index + 1) / job->band_count);
+    for (int y = first; y < end; y++) {
+        Uint8 *row = (Uint8 *)surface->pixels + (size_t)y * surface->pitch;
+        job->kernel(job->lut->nodes, row, surface->w, surface->format->BytesPerPixel, job->offsets);
+    }
+}
+
+// Byte position of an 8-bit channel within a pixel, or -1 when the mask is not one whole byte
+static int color_channel_offset(Uint32 mask, Uint8 shift) {
+    return (shift % 8 == 0 && (mask >> shift) == 0xFF) ? shift / 8 : -1;
+}
+
+// Converts decoded pixels in place from source to the display profile. Handles 8-bit palettes
+// and 24/32-bit pixels with byte-aligned channels; returns 0 when it left the surface alone.
+int color_transform_surface(ColorManager *color, const ColorProfile *source, SDL_Surface *surface,
+                            WorkerPool *workers) {
+    if (!source || !surface || !surface->pixels) {
+        return 0;
+    }
+    const ColorLut *lut = color_manager_lut(color, source);
+    if (!lut) {
+        return 0;
+    }
+
+    SDL_PixelFormat *format = surface->format;
+    if (format->palette) {
+        SDL_Palette *palette = format->palette;
+        SDL_Color colors[256];
+        int count = SDL_min(palette->ncolors, 256);
+        static const int offsets[3] = {0, 1, 2};
+        memcpy(colors, palette->colors, (size_t)count * sizeof(SDL_Color));
+        color_transform_row_scalar(lut->nodes, (Uint8 *)colors, count, (int)sizeof(SDL_Color), offsets);
+        SDL_SetPaletteColors(palette, colors, 0, count);
+        return 1;
+    }
+
+    ColorTransformJob job;
+    secure_memzero(&job, sizeof(job));
+    job.offsets[0] = color_channel_offset(format->Rmask, format->Rshift);
+    job.offsets[1] = color_channel_offset(format->Gmask, format->Gshift);
+    job.offsets[2] = color_channel_offset(format->Bmask, format->Bshift);
+    if (SDL_BYTEORDER != SDL_LIL_ENDIAN || (format->BytesPerPixel != 3 && format->BytesPerPixel != 4) ||
+        job.offsets[0] < 0 || job.offsets[1] < 0 || job.offsets[2] < 0) {
+        return 0;
+    }
+
+    job.lut = lut;
+    job.surface = surface;
+    job.kernel = color_transform_row_scalar;
+#ifdef PHOTON_X86_KERNELS
+    if (SDL_HasAVX2()) {
+        job.kernel = color_transform_row_avx2;
+    }
+#endif
+    int threads = workers ? workers->thread_count + 1 : 1;
+    job.band_count = SDL_max(1, SDL_min(surface->h, threads * PARALLEL_BANDS_PER_THREAD));
+    worker_pool_run(workers, color_transform_band, &job, job.band_count);
+    return 1;
+}
+
+// Metadata functions
+static int probe_png_header(const Uint8 *buf, size_t len, ImageMetadata *metadata) {
+    static const Uint8 signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    // Signature, IHDR length/type, then width, height, bit depth, color type
+    if (len < 26 || memcmp(buf, signature, sizeof(signature)) != 0 || memcmp(buf + 12, "IHDR", 4) != 0) {
+        return 0;
+    }
+
+    Uint32 width = read_be32(buf + 16);
+    Uint32 height = read_be32(buf + 20);
+    int bit_depth = buf[24];
+    int channels;
+
+    switch (buf[25]) {
+        case 0: channels = 1; break; // Grayscale
+        case 2: channels = 3; break; // RGB
+        case 3: channels = 1; break; // Palette
+        case 4: channels = 2; break; // Grayscale + alpha
+        case 6: channels = 4; break; // RGBA
+        default: return 0;
+    }
+
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF) {
+        return 0;
+    }
+
+    metadata->width = (int)width;
+    metadata->height = (int)height;
+    metadata->bits_per_pixel = bit_depth * channels;
+    secure_strncpy(metadata->format, "PNG", sizeof(metadata->format));
+    return 1;
+}
+
+static int probe_jpeg_header(SDL_RWops *rw, ImageMetadata *metadata) {
+    Uint8 marker[4];
+    Uint8 frame[6];
+
+    if (SDL_RWseek(rw, 2, RW_SEEK_SET) < 0) {
+        return 0;
+    }
+
+    // Walk the marker segments until the first SOFn frame header
+    for (;;) {
+        if (SDL_RWread(rw, marker, 1, 2) != 2 || marker[0] != 0xFF) {
+            return 0;
+        }
+
+        // Fill bytes may precede a marker
+        while (marker[1] == 0xFF) {
+            if (SDL_RWread(rw, &marker[1], 1, 1) != 1) {
+                return 0;
+            }
+        }
+
+        Uint8 type = marker[1];
+        if (type == 0xD8 || type == 0x01 || (type >= 0xD0 && type <= 0xD7)) {
+            continue; // Standalone markers carry no length
+        }
+        if (type == 0xD9 || type == 0xDA) {
+            return 0; // End of image or start of scan before any frame header
+        }
+
+        if (SDL_RWread(rw, &marker[2], 1, 2) != 2) {
+            return 0;
+        }
+        Uint16 segment_length = read_be16(&marker[2]);
+        if (segment_length < 2) {
+            return 0;
+        }
+
+        int is_sof = type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC;
+        if (is_sof) {
+            if (segment_length < 8 || SDL_RWread(rw, frame, 1, sizeof(frame)) != sizeof(frame)) {
+                return 0;
+            }
+
+            int precision = frame[0];
+            int height = read_be16(&frame[1]);
+            int width = read_be16(&frame[3]);
+            int components = frame[5];
+            if (width == 0 || height == 0 || components == 0) {
+                return 0;
+            }
+
+            metadata->width = width;
+            metadata->height = height;
+            metadata->bits_per_pixel = precision * components;
+            secure_strncpy(metadata->format, "JPEG", sizeof(metadata->format));
+            return 1;
+        }
+
+        if (SDL_RWseek(rw, segment_length - 2, RW_SEEK_CUR) < 0) {
+            return 0;
+        }
+    }
+}
+
+static int probe_bmp_header(const Uint8 *buf, size_t len, ImageMetadata *metadata) {
+    if (len < 26 || buf[0] != 'B' || buf[1] != 'M') {
+        return 0;
+    }
+
+    Uint32 header_size = read_le32(buf + 14);
+    Sint32 width;
+    Sint32 height;
+    int bit_count;
+
+    if (header_size == 12) {
+        // BITMAPCOREHEADER (OS/2)
+        width = read_le16(buf + 18);
+        height = read_le16(buf + 20);
+        bit_count = read_le16(buf + 24);
+    } else if (header_size >= 40 && len >= 30) {
+        // BITMAPINFOHEADER and its V4/V5 extensions; negative height means top-down
+        width = (Sint32)read_le32(buf + 18);
+        height = (Sint32)read_le32(buf + 22);
+        bit_count = read_le16(buf + 28);
+        if (height < 0 && height != INT32_MIN) {
+            height = -height;
+        }
+    } else {
+        return 0;
+    }
+
+    if (width <= 0 || height <= 0 || bit_count <= 0) {
+        return 0;
+    }
+
+    metadata->width = width;
+    metadata->height = height;
+    metadata->bits_per_pixel = bit_count;
+    secure_strncpy(metadata->format, "BMP", sizeof(metadata->format));
+    return 1;
+}
+
+static int probe_gif_header(const Uint8 *buf, size_t len, ImageMetadata *metadata) {
+    // Header followed by the logical screen descriptor
+    if (len < 13 || (memcmp(buf, "GIF87a", 6) != 0 && memcmp(buf, "GIF89a", 6) != 0)) {
+        return 0;
+    }
+
+    int width = read_le16(buf + 6);
+    int height = read_le16(buf + 8);
+    if (width == 0 || height == 0) {
+        return 0;
+    }
+
+    metadata->width = width;
+    metadata->height = height;
+    metadata->bits_per_pixel = 8;
+    secure_strncpy(metadata->format, "GIF", sizeof(metadata->format));
+    return 1;
+}
+
+// Reads dimensions, depth and format from the file header without decoding pixels
+int probe_image_header(SDL_RWops *rw, ImageMetadata *metadata) {
+    if (!rw || !metadata) {
+        return 0;
+    }
+
+    Uint8 header[32];
+    size_t len = SDL_RWread(rw, header, 1, sizeof(header));
+    if (len < 4) {
+        return 0;
+    }
+
+    if (header[0] == 0xFF && header[1] == 0xD8) {
+        return probe_jpeg_header(rw, metadata);
+    }
+
+    return probe_png_header(header, len, metadata) ||
+           probe_bmp_header(header, len, metadata) ||
+           probe_gif_header(header, len, metadata);
+}
+
+// "YYYY:MM:DD HH:MM:SS" with no zone, so it is taken as local time like the camera's clock
+static time_t exif_parse_time(const char *text) {
+    struct tm parsed;
+    secure_memzero(&parsed, sizeof(parsed));
+    if (sscanf(text, "%4d:%2d:%2d %2d:%2d:%2d", &parsed.tm_year, &parsed.tm_mon, &parsed.tm_mday,
+               &parsed.tm_hour, &parsed.tm_min, &parsed.tm_sec) != 6 || parsed.tm_year < 1900 ||
+        parsed.tm_mon < 1 || parsed.tm_mon > 12 || parsed.tm_mday < 1) {
+        return 0;
+    }
+    parsed.tm_year -= 1900;
+    parsed.tm_mon -= 1;
+    parsed.tm_isdst = -1;
+    time_t value = mktime(&parsed);
+    return value == (time_t)-1 ? 0 : value;
+}
+
+// Reads orientation, camera and capture time straight from the APP1 segment of the mapping
+static int probe_exif(const Uint8 *data, size_t size, ImageMetadata *metadata) {
+    ExifReader exif;
+    if (!exif_open_jpeg(data, size, &exif)) {
+        return 0;
+    }
+
+    size_t ifd0 = exif_first_ifd(&exif);
+    Uint32 orientation = exif_entry_value(&exif, exif_find_entry(&exif, ifd0, 0x0112));
+    if (orientation >= 1 && orientation <= 8) {
+        metadata->orientation = (int)orientation;
+    }
+    exif_entry_string(&exif, exif_find_entry(&exif, ifd0, 0x010F), metadata->camera_make,
+                      sizeof(metadata->camera_make));
+    exif_entry_string(&exif, exif_find_entry(&exif, ifd0, 0x0110), metadata->camera_model,
+                      sizeof(metadata->camera_model));
+
+    // DateTimeOriginal, falling back to IFD0's DateTime, which editors rewrite
+    char text[32];
+    size_t exif_ifd = exif_entry_value(&exif, exif_find_entry(&exif, ifd0, 0x8769));
+    if (exif_entry_string(&exif, exif_find_entry(&exif, exif_ifd, 0x9003), text, sizeof(text)) ||
+        exif_entry_string(&exif, exif_find_entry(&exif, ifd0, 0x0132), text, sizeof(text))) {
+        metadata->capture_time = exif_parse_time(text);
+    }
+    return 1;
+}
+
+// Fills metadata from an already mapped file; only the header pages are touched
+int extract_metadata_mapped(const char *filepath, const MappedFile *file, ImageMetadata *metadata) {
+    if (!filepath || !file || !file->data || !metadata) {
+        return 0;
+    }
+
+    SecurityResult sec_result = validate_filepath(filepath);
+    if (sec_result != SECURITY_OK) {
+        return 0;
+    }
+
+    secure_strncpy(metadata->filepath, filepath, sizeof(metadata->filepath));
+
+    const char *filename = strrchr(filepath, '/');
+    if (!filename) {
+        filename = strrchr(filepath, '\\');
+    }
+    if (filename) {
+        filename++;
+    } else {
+        filename = filepath;
+    }
+    
+    secure_strncpy(metadata->filename, filename, sizeof(metadata->filename));
+    sec_result = sanitize_filename(metadata->filename, sizeof(metadata->filename));
+    if (sec_result != SECURITY_OK) {
+        return 0;
+    }
+
+    secure_strncpy(metadata->format, get_format_name(filepath), sizeof(metadata->format));
+
+    metadata->file_size = (long)file->size;
+    metadata->creation_time = file->creation_time;
+    metadata->modification_time = file->modification_time;
+
+    metadata->width = 0;
+    metadata->height = 0;
+    metadata->bits_per_pixel = 0;
+    metadata->orientation = 1;
+    metadata->camera_make[0] = '\0';
+    metadata->camera_model[0] = '\0';
+    metadata->capture_time = 0;
+
+    SDL_RWops *rw = SDL_RWFromConstMem(file->data, (int)file->size);
+    if (rw) {
+        probe_image_header(rw, metadata);
+        SDL_RWclose(rw);
+    }
+    probe_exif(file->data, file->size, metadata);
+    color_space_detect(file->data, file->size, metadata->color_space, sizeof(metadata->color_space), NULL);
+
+    return 1;
+}
+
+int extract_metadata(const char *filepath, ImageMetadata *metadata) {
+    if (!filepath || !metadata || validate_filepath(filepath) != SECURITY_OK) {
+        return 0;
+    }
+
+    MappedFile file;
+    if (map_file(filepath, &file) != SECURITY_OK) {
+        return 0;
+    }
+
+    int ok = extract_metadata_mapped(filepath, &file, metadata);
+    unmap_file(&file);
+    return ok;
+}
+
+// Thumbnail cache functions
+static int make_directory(const char *path) {
+#ifdef _WIN32
+    return _mkdir(path) == 0 || errno == EEXIST;
+#else
+    return mkdir(path, 0700) == 0 || errno == EEXIST;
+#endif
+}
+
+// Creates every missing component of an absolute path
+static int make_directories(char *path) {
+    for (char *p = path + 1; *p; p++) {
+        if (*p == '/' || *p == '\\') {
+            char separator = *p;
+            *p = '\0';
+            int made = p[-1] == ':' || make_directory(path);
+            *p = separator;
+            if (!made) {
+                return 0;
+            }
+        }
+    }
+    return make_directory(path);
+}
+
+// $XDG_CACHE_HOME/photon, ~/.cache/photon, or %LOCALAPPDATA%\photon\cache on Windows
+int thumbnail_cache_init(ThumbnailCache *cache) {
+    secure_memzero(cache, sizeof(ThumbnailCache));
+
+#ifdef _WIN32
+    const char *base = getenv("LOCALAPPDATA");
+    const char *suffix = "\\photon\\cache";
+#else
+    const char *base = getenv("XDG_CACHE_HOME");
+    const char *suffix = "/photon";
+    if (!base || base[0] != '/') {
+        base = getenv("HOME");
+        suffix = "/.cache/photon";
+    }
+#endif
+    if (!base || !base[0]) {
+        return 0;
+    }
+
+    int written = snprintf(cache->directory, sizeof(cache->directory), "%s%s", base, suffix);
+    if (written <= 0 || (size_t)written >= sizeof(cache->directory) || !make_directories(cache->directory)) {
+        SDL_Log("Thumbnail cache disabled: cannot create %s", cache->directory);
+        cache->directory[0] = '\0';
+        return 0;
+    }
+
+    cache->enabled = 1;
+    return 1;
+}
+
+// Entries are keyed on the absolute, resolved path so every spelling of a file shares one entry;
+// the path as given is used when it cannot be resolved
+static void thumbnail_cache_key(const char *image_path, char *out, size_t out_size) {
+#ifdef _WIN32
+    if (!_fullpath(out, image_path, out_size)) {
+        secure_strncpy(out, image_path, out_size);
+    }
+#else
+    char *resolved = realpath(image_path, NULL);
+    secure_strncpy(out, resolved ? resolved : image_path, out_size);
+    free(resolved);
+#endif
+}
+
+// FNV-1a of the image path names the cache file; the full path inside guards against collisions
+static int thumbnail_cache_file(const ThumbnailCache *cache, const char *image_path, char *out, size_t out_size) {
+    Uint64 hash = 1469598103934665603ULL;
+    for (const char *p = image_path; *p; p++) {
+        hash = (hash ^ (Uint8)*p) * 1099511628211ULL;
+    }
+
+    int written = snprintf(out, out_size, "%s/%08x%08x.thumb", cache->directory,
+                           (unsigned int)(hash >> 32), (unsigned int)hash);
+    return written > 0 && (size_t)written < out_size;
+}
+
+// Scaled-down ARGB8888 copy from the smallest mip level that is still large enough
+SDL_Surface *create_thumbnail(PixelPool *pool, SDL_Surface **levels, int level_count) {
+    if (!levels || level_count < 1 || !levels[0]) {
+        return NULL;
+    }
+
+    int level = 0;
+    while (level + 1 < level_count && SDL_max(levels[level + 1]->w, levels[level + 1]->h) >= THUMBNAIL_SIZE) {
+        level++;
+    }
+
+    SDL_Surface *thumbnail = convert_surface_format(pool, levels[level], SDL_PIXELFORMAT_ARGB8888);
+    while (thumbnail && SDL_max(thumbnail->w, thumbnail->h) > THUMBNAIL_SIZE) {
+        SDL_Surface *smaller = downsample_surface_2x(pool, thumbnail);
+        release_surface(thumbnail);
+        thumbnail = smaller;
+    }
+    return thumbnail;
+}
+
+// Returns 1 when the entry matches the file's mtime and size; the thumbnail is optional
+int thumbnail_cache_lookup(const ThumbnailCache *cache, const char *image_path, time_t modification_time,
+                           long file_size, SDL_Surface **thumbnail) {
+    char cache_path[MAX_PATH_LENGTH];
+    char key[MAX_PATH_LENGTH];
+    if (!cache || !cache->enabled || !image_path) {
+        return 0;
+    }
+    thumbnail_cache_key(image_path, key, sizeof(key));
+    if (!thumbnail_cache_file(cache, key, cache_path, sizeof(cache_path))) {
+        return 0;
+    }
+
+    FILE *file = fopen(cache_path, "rb");
+    if (!file) {
+        return 0;
+    }
+
+    Uint8 header[THUMBNAIL_HEADER_CAPACITY];
+    size_t length = fread(header, 1, sizeof(header), file);
+    size_t path_length = strlen(key);
+    size_t pos = 10 + path_length;
+    int fresh = length >= pos + 20 && memcmp(header, THUMBNAIL_MAGIC, 4) == 0 &&
+                read_le32(header + 4) == THUMBNAIL_VERSION && read_le16(header + 8) == path_length &&
+                memcmp(header + 10, key, path_length) == 0 &&
+                read_le64(header + pos) == (Sint64)modification_time &&
+                read_le64(header + pos + 8) == (Sint64)file_size;
+    if (!fresh || !thumbnail) {
+        fclose(file);
+        return fresh;
+    }
+
+    int width = read_le16(header + pos + 16);
+    int height = read_le16(header + pos + 18);
+    pos += 20;
+    if (width <= 0 || height <= 0 || width > THUMBNAIL_SIZE || height > THUMBNAIL_SIZE) {
+        fclose(file);
+        return 0;
+    }
+
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+    int loaded = surface && fseek(file, (long)pos, SEEK_SET) == 0;
+    for (int y = 0; loaded && y < height; y++) {
+        loaded = fread((Uint8 *)surface->pixels + (size_t)y * surface->pitch, 4, (size_t)width, file) == (size_t)width;
+    }
+    fclose(file);
+    if (!loaded) {
+        if (surface) {
+            SDL_FreeSurface(surface);
+        }
+        return 0;
+    }
+    *thumbnail = surface;
+    return 1;
+}
+
+// Writes to a temporary file and renames it, so readers never see a partial entry
+int thumbnail_cache_store(const ThumbnailCache *cache, const char *image_path, const ImageMetadata *metadata,
+                          SDL_Surface *thumbnail) {
+    char cache_path[MAX_PATH_LENGTH];
+    char temp_path[MAX_PATH_LENGTH + 8];
+    char key[MAX_PATH_LENGTH];
+    if (!cache || !cache->enabled || !image_path || !metadata || !thumbnail ||
+        thumbnail->format->format != SDL_PIXELFORMAT_ARGB8888) {
+        return 0;
+    }
+    thumbnail_cache_key(image_path, key, sizeof(key));
+    if (!thumbnail_cache_file(cache, key, cache_path, sizeof(cache_path))) {
+        return 0;
+    }
+
+    size_t path_length = strlen(key);
+    if (path_length > MAX_PATH_LENGTH) {
+        return 0;
+    }
+
+    Uint8 header[THUMBNAIL_HEADER_CAPACITY];
+    memcpy(header, THUMBNAIL_MAGIC, 4);
+    write_le32(header + 4, THUMBNAIL_VERSION);
+    write_le16(header + 8, (Uint16)path_length);
+    memcpy(header + 10, key, path_length);
+    size_t pos = 10 + path_length;
+    write_le64(header + pos, (Sint64)metadata->modification_time);
+    write_le64(header + pos + 8, (Sint64)metadata->file_size);
+    write_le16(header + pos + 16, (Uint16)thumbnail->w);
+    write_le16(header + pos + 18, (Uint16)thumbnail->h);
+    pos += 20;
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache_path);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        return 0;
+    }
+
+    int written = fwrite(header, 1, pos, file) == pos;
+    for (int y = 0; written && y < thumbnail->h; y++) {
+        written = fwrite((const Uint8 *)thumbnail->pixels + (size_t)y * thumbnail->pitch, 4,
+                         (size_t)thumbnail->w, file) == (size_t)thumbnail->w;
+    }
+    written = fclose(file) == 0 && written;
+
+#ifdef _WIN32
+    written = written && MoveFileExA(temp_path, cache_path, MOVEFILE_REPLACE_EXISTING);
+#else
+    written = written && rename(temp_path, cache_path) == 0;
+#endif
+    if (!written) {
+        remove(temp_path);
+    }
+    return written;
+}
+
+// Background loading functions
+void load_result_free(LoadResult *load) {
+    if (!load) {
+        return;
+    }
+
+    free_surface_levels(load->levels, load->level_count);
+    memory_budget_refund(load->memory, load->cpu_bytes);
+    progressive_image_free(load->stream);
+    secure_memzero(load, sizeof(LoadResult));
+    safe_free((void **)&load);
+}
+
+void thumbnail_result_free(ThumbnailResult *result) {
+    if (!result) {
+        return;
+    }
+
+    release_surface(result->thumbnail);
+    secure_memzero(result, sizeof(ThumbnailResult));
+    safe_free((void **)&result);
+}
+
+// Cached thumbnail when the key still matches, otherwise a full decode that refreshes the cache.
+// The cache holds source pixels, as the scanner writes them; tagged images are converted for the
+// display only on the way to the grid. The orientation is read from the header either way.
+static void load_thumbnail(ImageLoader *loader, ThumbnailResult *result) {
+    struct stat file_stat;
+    MappedFile file;
+    result->orientation = 1;
+    if (validate_filepath(result->filepath) != SECURITY_OK || stat(result->filepath, &file_stat) != 0 ||
+        map_file(result->filepath, &file) != SECURITY_OK) {
+        return;
+    }
+
+    ColorProfile source;
+    int managed = color_space_detect(file.data, file.size, NULL, 0, &source);
+    ImageMetadata metadata;
+    secure_memzero(&metadata, sizeof(metadata));
+    if (thumbnail_cache_lookup(loader->thumbnails, result->filepath, file_stat.st_mtime, (long)file_stat.st_size,
+                               &result->thumbnail)) {
+        metadata.orientation = 1;
+        probe_exif(file.data, file.size, &metadata);
+        result->orientation = metadata.orientation;
+        unmap_file(&file);
+    } else {
+        extract_metadata_mapped(result->filepath, &file, &metadata);
+        result->orientation = metadata.orientation;
+
+        SDL_Surface *levels[MAX_MIP_LEVELS] = {0};
+        int decoded =
+            decode_image_reduced(&file, &metadata, loader->pool, THUMBNAIL_SIZE, THUMBNAIL_SIZE, &levels[0]) ||
+            decode_image_parallel(&file, loader->workers, loader->pool, &levels[0]) ||
+            decode_image_mapped(&file, result->filepath, &levels[0]) == SECURITY_OK;
+        unmap_file(&file);
+        if (!decoded) {
+            return;
+        }
+
+        int level_count = build_mip_levels(loader->pool, levels, MAX_MIP_LEVELS);
+        result->thumbnail = create_thumbnail(loader->pool, levels, level_count);
+        thumbnail_cache_store(loader->thumbnails, result->filepath, &metadata, result->thumbnail);
+        free_surface_levels(levels, level_count);
+    }
+
+    if (managed && result->thumbnail) {
+        color_transform_surface(loader->color, &source, result->thumbnail, loader->workers);
+    }
+}
+
+static int image_loader_thread(void *data) {
+    ImageLoader *loader = (ImageLoader *)data;
+
+    SDL_LockMutex(loader->lock);
+    while (!loader->quit) {
+        if (!loader->has_pending && loader->prefetch_count == 0 && loader->thumbnail_next >= loader->thumbnail_count) {
+            SDL_CondWait(loader->wake, loader->lock);
+            continue;
+        }
+
+        // Thumbnails only run while no full-size image is waiting
+        if (!loader->has_pending && loader->prefetch_count == 0) {
+            ThumbnailResult *thumbnail = NULL;
+            if (safe_malloc((void **)&thumbnail, sizeof(ThumbnailResult)) != SECURITY_OK) {
+                loader->thumbnail_count = 0;
+                continue;
+            }
+            memcpy(thumbnail->filepath, loader->thumbnail_paths[loader->thumbnail_next], sizeof(thumbnail->filepath));
+            thumbnail->index = loader->thumbnail_indices[loader->thumbnail_next];
+            loader->thumbnail_next++;
+            SDL_UnlockMutex(loader->lock);
+
+            load_thumbnail(loader, thumbnail);
+            if (!result_ring_push(&loader->results, LOADER_EVENT_THUMBNAIL, thumbnail)) {
+                thumbnail_result_free(thumbnail);
+            }
+
+            SDL_LockMutex(loader->lock);
+            continue;
+        }
+
+        LoadResult *load = NULL;
+        if (safe_malloc((void **)&load, sizeof(LoadResult)) != SECURITY_OK) {
+            loader->has_pending = 0;
+            loader->prefetch_count = 0;
+            continue;
+        }
+
+        // The image the user asked for always goes ahead of prefetches
+        int reduce_width = loader->reduce_width;
+        int reduce_height = loader->reduce_height;
+        int upgrade = 0;
+        if (loader->has_pending) {
+            memcpy(load->filepath, loader->pending_path, sizeof(load->filepath));
+            loader->has_pending = 0;
+            upgrade = loader->pending_full;
+            if (upgrade) {
+                reduce_width = 0;
+                reduce_height = 0;
+            }
+        } else {
+            memcpy(load->filepath, loader->prefetch_paths[0], sizeof(load->filepath));
+            load->prefetch = 1;
+            loader->prefetch_count--;
+            memmove(loader->prefetch_paths[0], loader->prefetch_paths[1],
+                    (size_t)loader->prefetch_count * MAX_PATH_LENGTH);
+        }
+        memcpy(loader->active_path, load->filepath, sizeof(loader->active_path));
+        loader->active = 1;
+        load->memory = loader->memory;
+        SDL_UnlockMutex(loader->lock);
+
+        // One mapping feeds validation, decode and the header probe
+        MappedFile file;
+        ColorProfile source;
+        int managed = 0;
+        int thumbnail_fresh = 1;
+        Uint64 start = SDL_GetPerformanceCounter();
+        load->result = validate_filepath(load->filepath);
+        if (load->result == SECURITY_OK) {
+            load->result = map_file(load->filepath, &file);
+        }
+        load->stage_ms[STATS_STAGE_OPEN] = stats_elapsed_ms(start);
+        if (load->result == SECURITY_OK) {
+            start = SDL_GetPerformanceCounter();
+            extract_metadata_mapped(load->filepath, &file, &load->metadata);
+            thumbnail_fresh = thumbnail_cache_lookup(loader->thumbnails, load->filepath, file.modification_time,
+                                                     (long)file.size, NULL);
+            load->stage_ms[STATS_STAGE_METADATA] = stats_elapsed_ms(start);
+            start = SDL_GetPerformanceCounter();
+
+            // Very large JPEGs split across cores; other large images the user is waiting on
+            // are shown while they decode. Prefetches give way under memory pressure and are
+            // decoded when opened instead.
+            // Fitted views of large JPEG/PNG files decode straight to window size instead.
+            if (orientation_swaps_axes(load->metadata.orientation)) {
+                int fit_width = reduce_width;
+                reduce_width = reduce_height;
+                reduce_height = fit_width;
+            }
+            int fits = memory_budget_allows(loader->memory, loader->pool, &load->metadata);
+            if (!fits && !load->prefetch) {
+                pixel_pool_trim(loader->pool);
+                fits = memory_budget_allows(loader->memory, loader->pool, &load->metadata);
+            }
+
+            // An opened image over what is left of the CPU cap is decoded reduced to fit, before
+            // anything is allocated for it; upgrades and images with no reduced path are refused
+            int skipped = !fits && (load->prefetch || upgrade);
+            int factor = !fits && !skipped ? memory_budget_reduction(loader->memory, loader->pool, &load->metadata) : 0;
+            if (factor > decode_reduction_for(load->metadata.width, load->metadata.height, reduce_width,
+                                              reduce_height)) {
+                reduce_width = (load->metadata.width + factor - 1) / factor;
+                reduce_height = (load->metadata.height + factor - 1) / factor;
+            }
+            load->reduced = !skipped && (fits || factor > 0) &&
+                            decode_image_reduced(&file, &load->metadata, loader->pool, reduce_width, reduce_height,
+                                                 &load->levels[0]);
+            skipped = skipped || (!fits && !load->reduced);
+            if (skipped && !load->prefetch) {
+                SDL_Log("Over CPU budget: %s not decoded", load->filepath);
+            }
+            int streamed = skipped || load->reduced ||
+                           decode_image_parallel(&file, loader->workers, loader->pool, &load->levels[0]);
+            if (!streamed && !load->prefetch && !upgrade &&
+                (long long)load->metadata.width * load->metadata.height >= STREAM_MIN_PIXELS) {
+                load->stream = progressive_image_create(load->filepath, load->metadata.width,
+                                                        load->metadata.height, &loader->results);
+                if (load->stream) {
+                    load->stream->orientation = load->metadata.orientation;
+                }
+                streamed = load->stream &&
+                           decode_image_streaming(&file, &load->metadata, load->stream, loader->pool,
+                                                  &load->levels[0]);
+            }
+            if (skipped) {
+                load->result = SECURITY_ERROR_MEMORY_ALLOCATION;
+            } else if (!streamed) {
+                load->result = decode_image_mapped(&file, load->filepath, &load->levels[0]);
+            }
+            managed = load->result == SECURITY_OK && color_space_detect(file.data, file.size, NULL, 0, &source);
+            unmap_file(&file);
+            load->stage_ms[STATS_STAGE_DECODE] = stats_elapsed_ms(start);
+        }
+        if (load->result == SECURITY_OK) {
+            // Tagged images are converted to the display profile before mips are built from them;
+            // progressive previews of such images show the untransformed pixels until this point
+            start = SDL_GetPerformanceCounter();
+            if (managed) {
+                color_transform_surface(loader->color, &source, load->levels[0], loader->workers);
+            }
+            load->level_count = build_mip_levels(loader->pool, load->levels, MAX_MIP_LEVELS);
+            load->stage_ms[STATS_STAGE_CONVERT] = stats_elapsed_ms(start);
+
+            // Levels that alone would overrun the GPU budget are dropped before they are queued
+            load->full_width = load->reduced ? load->metadata.width : load->levels[0]->w;
+            load->full_height = load->reduced ? load->metadata.height : load->levels[0]->h;
+            if (loader->memory) {
+                int skip = memory_budget_levels_over(load->levels, load->level_count, loader->memory->gpu_cap);
+                free_surface_levels(load->levels, skip);
+                memmove(load->levels, load->levels + skip, (size_t)(load->level_count - skip) * sizeof(SDL_Surface *));
+                load->level_count -= skip;
+                load->skipped_levels = skip;
+            }
+            for (int i = 0; i < load->level_count; i++) {
+                load->cpu_bytes += surface_bytes(load->levels[i]);
+            }
+            memory_budget_charge(load->memory, load->cpu_bytes);
+        }
+
+        // Missing or stale thumbnails are rewritten from the levels just decoded. Tagged images
+        // are left to the grid's own decode, as their levels are already in display space.
+        if (load->result == SECURITY_OK && !thumbnail_fresh && !managed) {
+            SDL_Surface *thumbnail = create_thumbnail(loader->pool, load->levels, load->level_count);
+            thumbnail_cache_store(loader->thumbnails, load->filepath, &load->metadata, thumbnail);
+            release_surface(thumbnail);
+        }
+
+        // Progress notifications for this image are ahead of it in the ring, so the main
+        // thread is done with the stream by the time it frees it with the result
+        if (!result_ring_push(&loader->results, LOADER_EVENT_COMPLETE, load)) {
+            load_result_free(load);
+        }
+
+        SDL_LockMutex(loader->lock);
+        loader->active = 0;
+    }
+    SDL_UnlockMutex(loader->lock);
+
+    return 0;
+}
+
+void image_loader_stop(ImageLoader *loader) {
+    if (!loader) {
+        return;
+    }
+
+    if (loader->thread) {
+        SDL_AtomicSet(&loader->results.closed, 1);
+        SDL_LockMutex(loader->lock);
+        loader->quit = 1;
+        SDL_CondSignal(loader->wake);
+        SDL_UnlockMutex(loader->lock);
+
+        // An in-flight decode cannot be interrupted, so this waits for it to finish
+        SDL_WaitThread(loader->thread, NULL);
+        loader->thread = NULL;
+    }
+
+    // Release results that were delivered but never handled
+    ResultSlot slot;
+    while (result_ring_pop(&loader->results, &slot)) {
+        // Progress entries only borrow a stream owned by a later completion
+        if (slot.code == LOADER_EVENT_COMPLETE) {
+            load_result_free((LoadResult *)slot.data);
+        } else if (slot.code == LOADER_EVENT_THUMBNAIL) {
+            thumbnail_result_free((ThumbnailResult *)slot.data);
+        }
+    }
+
+    safe_free((void **)&loader->thumbnail_paths);
+    safe_free((void **)&loader->thumbnail_indices);
+
+    if (loader->wake) {
+        SDL_DestroyCond(loader->wake);
+        loader->wake = NULL;
+    }
+    if (loader->lock) {
+        SDL_DestroyMutex(loader->lock);
+        loader->lock = NULL;
+    }
+}
+
+int image_loader_start(ImageLoader *loader, PixelPool *pool, WorkerPool *workers, ThumbnailCache *thumbnails,
+                       MemoryBudget *memory, ColorManager *color) {
+    if (!loader) {
+        return 0;
+    }
+
+    loader->pool = pool;
+    loader->workers = workers;
+    loader->thumbnails = thumbnails;
+    loader->memory = memory;
+    loader->color = color;
+
+    loader->results.event_type = SDL_RegisterEvents(1);
+    if (loader->results.event_type == (Uint32)-1) {
+        SDL_Log("Failed to register loader event: %s", SDL_GetError());
+        return 0;
+    }
+
+    loader->lock = SDL_CreateMutex();
+    loader->wake = SDL_CreateCond();
+    if (!loader->lock || !loader->wake) {
+        SDL_Log("Failed to create loader synchronization: %s", SDL_GetError());
+        image_loader_stop(loader);
+        return 0;
+    }
+
+    if (safe_malloc((void **)&loader->thumbnail_paths, (size_t)GRID_MAX_SLOTS * MAX_PATH_LENGTH) != SECURITY_OK ||
+        safe_malloc((void **)&loader->thumbnail_indices, GRID_MAX_SLOTS * sizeof(int)) != SECURITY_OK) {
+        SDL_Log("Failed to allocate thumbnail queue");
+        image_loader_stop(loader);
+        return 0;
+    }
+
+    loader->quit = 0;
+    loader->has_pending = 0;
+    loader->prefetch_count = 0;
+    loader->thumbnail_next = 0;
+    loader->thumbnail_count = 0;
+    loader->active = 0;
+    loader->thread = SDL_CreateThread(image_loader_thread, "photon-loader", loader);
+    if (!loader->thread) {
+        SDL_Log("Failed to create loader thread: %s", SDL_GetError());
+        image_loader_stop(loader);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Reduced decodes target the window while the view fits images to it
+static void image_loader_set_target(ImageLoader *loader, const App *app) {
+    loader->reduce_width = app->fit_to_window ? app->window_width : 0;
+    loader->reduce_height = app->fit_to_window ? app->window_height : 0;
+}
+
+// Replaces the prefetch queue; entries not yet started are dropped
+void image_loader_prefetch(App *app, char paths[][MAX_PATH_LENGTH], int count) {
+    ImageLoader *loader = &app->loader;
+    if (!loader->thread || count < 0) {
+        return;
+    }
+
+    SDL_LockMutex(loader->lock);
+    image_loader_set_target(loader, app);
+    loader->prefetch_count = 0;
+    for (int i = 0; i < count && loader->prefetch_count < PREFETCH_RADIUS * 2; i++) {
+        if (loader->active && strcmp(loader->active_path, paths[i]) == 0) {
+            continue;
+        }
+        memcpy(loader->prefetch_paths[loader->prefetch_count++], paths[i], MAX_PATH_LENGTH);
+    }
+    if (loader->prefetch_count > 0) {
+        SDL_CondSignal(loader->wake);
+    }
+    SDL_UnlockMutex(loader->lock);
+}
+
+// Queues a decode on the loader thread; a newer request supersedes one not yet started
+int load_image(App *app, const char *image_path) {
+    if (!app || !image_path || !app->loader.thread) {
+        return 0;
+    }
+
+    SecurityResult result = validate_filepath(image_path);
+    if (result != SECURITY_OK) {
+        report_load_result(app, image_path, result);
+        return 0;
+    }
+
+    secure_strncpy(app->current_path, image_path, sizeof(app->current_path));
+    app->loading = 1;
+    app->needs_redraw = 1;
+
+    ImageLoader *loader = &app->loader;
+    SDL_LockMutex(loader->lock);
+    image_loader_set_target(loader, app);
+    loader->pending_full = 0;
+    if (loader->active && strcmp(loader->active_path, image_path) == 0) {
+        // Already being decoded as a prefetch; its result will be shown on arrival
+        loader->has_pending = 0;
+    } else {
+        secure_strncpy(loader->pending_path, image_path, sizeof(loader->pending_path));
+        loader->has_pending = 1;
+        SDL_CondSignal(loader->wake);
+    }
+    SDL_UnlockMutex(loader->lock);
+
+    return 1;
+}
+
+// Full-size decode of the image on screen; the reduced one stays up until it arrives
+void image_loader_upgrade(App *app) {
+    ImageLoader *loader = &app->loader;
+    if (!loader->thread) {
+        return;
+    }
+
+    SDL_LockMutex(loader->lock);
+    memcpy(loader->pending_path, app->current_path, sizeof(loader->pending_path));
+    loader->has_pending = 1;
+    loader->pending_full = 1;
+    SDL_CondSignal(loader->wake);
+    SDL_UnlockMutex(loader->lock);
+}
+
+// Animation functions
+static Uint64 animation_ticks(void) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    return SDL_GetTicks64();
+#else
+    return SDL_GetTicks();
+#endif
+}
+
+// Follows a chain of GIF data sub-blocks up to and including its terminator
+static int gif_skip_sub_blocks(const Uint8 *data, size_t size, size_t *position) {
+    while (*position < size) {
+        Uint8 length = data[(*position)++];
+        if (length == 0) {
+            return 1;
+        }
+        *position += length;
+    }
+    return 0;
+}
+
+static void gif_read_palette(const Uint8 *data, int count, Uint32 *palette) {
+    for (int i = 0; i < count; i++) {
+        palette[i] = 0xFF000000u | ((Uint32)data[i * 3] << 16) | ((Uint32)data[i * 3 + 1] << 8) | data[i * 3 + 2];
+    }
+}
+
+// Parses the screen descriptor and counts frames; returns 0 when the data is not a usable GIF
+int gif_decoder_init(GifDecoder *gif, const Uint8 *data, size_t size) {
+    secure_memzero(gif, sizeof(GifDecoder));
+    if (size < 13 || (memcmp(data, "GIF87a", 6) != 0 && memcmp(data, "GIF89a", 6) != 0)) {
+        return 0;
+    }
+
+    gif->data = data;
+    gif->size = size;
+    gif->width = read_le16(data + 6);
+    gif->height = read_le16(data + 8);
+    if (gif->width == 0 || gif->height == 0 || gif->width > MAX_IMAGE_DIMENSION ||
+        gif->height > MAX_IMAGE_DIMENSION) {
+        return 0;
+    }
+
+    size_t position = 13;
+    if (data[10] & 0x80) {
+        gif->global_palette_size = 2 << (data[10] & 7);
+        if (position + (size_t)gif->global_palette_size * 3 > size) {
+            return 0;
+        }
+        gif_read_palette(data + position, gif->global_palette_size, gif->global_palette);
+        position += (size_t)gif->global_palette_size * 3;
+    }
+    gif->first_frame = position;
+    gif->position = position;
+
+    // Only block headers are read here; frames whose data runs past the end are not counted
+    int frames = 0;
+    while (position < size) {
+        Uint8 block = data[position++];
+        if (block == 0x21 && position < size) {
+            position++;
+            if (!gif_skip_sub_blocks(data, size, &position)) {
+                break;
+            }
+        } else if (block == 0x2C && position + 9 <= size) {
+            Uint8 flags = data[position + 8];
+            position += 9;
+            if (flags & 0x80) {
+                position += (size_t)3 * (2 << (flags & 7));
+            }
+            position++;
+            if (position > size) {
+                break;
+            }
+
+            // A truncated final image still shows what was transferred, as in browsers
+            frames++;
+            if (!gif_skip_sub_blocks(data, size, &position)) {
+                break;
+            }
+        } else {
+            break;
+        }
+    }
+    return frames;
+}
+
+void gif_decoder_free(GifDecoder *gif) {
+    safe_free((void **)&gif->canvas);
+    safe_free((void **)&gif->previous);
+}
+
+static void gif_decoder_rewind(GifDecoder *gif) {
+    gif->position = gif->first_frame;
+    gif->frame_index = 0;
+    gif->dispose = 0;
+    memset(gif->canvas, 0, (size_t)gif->width * gif->height * sizeof(Uint32));
+}
+
+// Variable-width LZW codes packed LSB-first across length-prefixed sub-blocks
+typedef struct {
+    const Uint8 *data;
+    size_t size;
+    size_t position;
+    size_t block_end;
+    Uint32 bits;
+    int bit_count;
+    int ended;
+} GifBitReader;
+
+static int gif_read_code(GifBitReader *reader, int width) {
+    while (reader->bit_count < width) {
+        if (reader->position == reader->block_end) {
+            if (reader->ended || reader->position >= reader->size || reader->data[reader->position] == 0) {
+                reader->position += reader->position < reader->size;
+                reader->ended = 1;
+                return -1;
+            }
+            Uint8 length = reader->data[reader->position++];
+            reader->block_end = reader->position + length;
+            if (reader->block_end > reader->size) {
+                reader->block_end = reader->size;
+            }
+            continue;
+        }
+        reader->bits |= (Uint32)reader->data[reader->position++] << reader->bit_count;
+        reader->bit_count += 8;
+    }
+
+    int code = (int)(reader->bits & ((1u << width) - 1));
+    reader->bits >>= width;
+    reader->bit_count -= width;
+    return code;
+}
+
+// Decodes one image's LZW stream straight onto the canvas, skipping transparent pixels
+static void gif_draw_image(GifDecoder *gif, GifBitReader *reader, int min_code_size, const SDL_Rect *rect,
+                           int interlaced, const Uint32 *palette, int palette_size, int transparent) {
+    static const int pass_start[4] = {0, 4, 2, 1};
+    static const int pass_step[4] = {8, 8, 4, 2};
+    int clear = 1 << min_code_size;
+    int width = min_code_size + 1;
+    int next = clear + 2;
+    int previous = -1;
+    int first = 0;
+    int x = 0;
+    int y = 0;
+    int pass = 0;
+
+    for (;;) {
+        int code = gif_read_code(reader, width);
+        if (code < 0 || code == clear + 1) {
+            return;
+        }
+        if (code == clear) {
+            width = min_code_size + 1;
+            next = clear + 2;
+            previous = -1;
+            continue;
+        }
+
+        int length = 0;
+        int current = code;
+        if (previous < 0) {
+            if (code > clear) {
+                return;
+            }
+            first = code;
+            gif->stack[length++] = (Uint8)code;
+        } else {
+            if (code > next) {
+                return;
+            }
+            if (code == next) {
+                gif->stack[length++] = (Uint8)first;
+                current = previous;
+            }
+            while (current >= clear && length < 4096) {
+                gif->stack[length++] = gif->suffix[current];
+                current = gif->prefix[current];
+            }
+            first = current;
+            gif->stack[length++] = (Uint8)current;
+
+            if (next < 4096) {
+                gif->prefix[next] = (Uint16)previous;
+                gif->suffix[next] = (Uint8)first;
+                next++;
+                if (next == (1 << width) && width < 12) {
+                    width++;
+                }
+            }
+        }
+        previous = code;
+
+        // The stack holds the string last character first
+        while (length > 0) {
+            int index = gif->stack[--length];
+            if (y >= rect->h) {
+                continue;
+            }
+
+            int canvas_x = rect->x + x;
+            int canvas_y = rect->y + y;
+            if (index != transparent && index < palette_size && canvas_x < gif->width && canvas_y < gif->height) {
+                gif->canvas[(size_t)canvas_y * gif->width + canvas_x] = palette[index];
+            }
+
+            if (++x == rect->w) {
+                x = 0;
+                if (!interlaced) {
+                    y++;
+                } else {
+                    y += pass_step[pass];
+                    while (y >= rect->h && pass < 3) {
+                        pass++;
+                        y = pass_start[pass];
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void gif_fill_rect(GifDecoder *gif, const SDL_Rect *rect, const Uint32 *source) {
+    for (int y = rect->y; y < rect->y + rect->h; y++) {
+        Uint32 *row = gif->canvas + (size_t)y * gif->width + rect->x;
+        if (source) {
+            memcpy(row, source + (size_t)y * gif->width + rect->x, (size_t)rect->w * sizeof(Uint32));
+        } else {
+            memset(row, 0, (size_t)rect->w * sizeof(Uint32));
+        }
+    }
+}
+
+// Composites the next frame onto the canvas, wrapping to the first after the trailer
+int gif_decode_frame(GifDecoder *gif, Uint32 *delay_ms) {
+    const Uint8 *data = gif->data;
+    int delay_cs = 0;
+    int transparent = -1;
+    int dispose = 0;
+    int wrapped = 0;
+
+    for (;;) {
+        if (gif->position >= gif->size || data[gif->position] == 0x3B) {
+            if (wrapped || gif->frame_index == 0) {
+                return 0;
+            }
+            gif_decoder_rewind(gif);
+            wrapped = 1;
+            continue;
+        }
+
+        Uint8 block = data[gif->position++];
+        if (block == 0x2C) {
+            break;
+        }
+        if (block != 0x21 || gif->position >= gif->size) {
+            return 0;
+        }
+
+        Uint8 label = data[gif->position++];
+        if (label == 0xF9 && gif->position + 5 <= gif->size && data[gif->position] == 4) {
+            Uint8 flags = data[gif->position + 1];
+            dispose = (flags >> 2) & 7;
+            delay_cs = read_le16(data + gif->position + 2);
+            transparent = (flags & 1) ? data[gif->position + 4] : -1;
+        }
+        if (!gif_skip_sub_blocks(data, gif->size, &gif->position)) {
+            return 0;
+        }
+    }
+
+    if (gif->position + 10 > gif->size) {
+        return 0;
+    }
+    const Uint8 *descriptor = data + gif->position;
+    SDL_Rect rect = {read_le16(descriptor), read_le16(descriptor + 2), read_le16(descriptor + 4),
+                     read_le16(descriptor + 6)};
+    Uint8 flags = descriptor[8];
+    gif->position += 9;
+
+    Uint32 local_palette[256];
+    const Uint32 *palette = gif->global_palette;
+    int palette_size = gif->global_palette_size;
+    if (flags & 0x80) {
+        palette_size = 2 << (flags & 7);
+        if (gif->position + (size_t)palette_size * 3 > gif->size) {
+            return 0;
+        }
+        gif_read_palette(data + gif->position, palette_size, local_palette);
+        palette = local_palette;
+        gif->position += (size_t)palette_size * 3;
+    }
+
+    int min_code_size = gif->position < gif->size ? data[gif->position++] : 0;
+    if (min_code_size < 2 || min_code_size > 11) {
+        return 0;
+    }
+
+    // The previous frame's disposal applies before this one is drawn
+    if (gif->dispose == 2) {
+        gif_fill_rect(gif, &gif->dispose_rect, NULL);
+    } else if (gif->dispose == 3 && gif->previous) {
+        gif_fill_rect(gif, &gif->dispose_rect, gif->previous);
+    }
+
+    SDL_Rect canvas_rect = {0, 0, gif->width, gif->height};
+    SDL_Rect clipped;
+    if (!SDL_IntersectRect(&rect, &canvas_rect, &clipped)) {
+        clipped.w = 0;
+        clipped.h = 0;
+    }
+    if (dispose == 3) {
+        if (!gif->previous && safe_malloc_uninitialized((void **)&gif->previous,
+                                                        (size_t)gif->width * gif->height * sizeof(Uint32)) !=
+                                  SECURITY_OK) {
+            dispose = 0;
+        } else {
+            memcpy(gif->previous, gif->canvas, (size_t)gif->width * gif->height * sizeof(Uint32));
+        }
+    }
+
+    GifBitReader reader = {data, gif->size, gif->position, gif->position, 0, 0, 0};
+    if (rect.w > 0 && rect.h > 0) {
+        gif_draw_image(gif, &reader, min_code_size, &rect, flags & 0x40, palette, palette_size, transparent);
+    }
+    if (!reader.ended) {
+        reader.position = reader.block_end;
+        if (!gif_skip_sub_blocks(data, gif->size, &reader.position)) {
+            reader.position = gif->size;
+        }
+    }
+    gif->position = SDL_min(reader.position, gif->size);
+
+    gif->dispose = dispose;
+    gif->dispose_rect = clipped;
+    gif->frame_index++;
+    *delay_ms = delay_cs * 10 < ANIMATION_MIN_DELAY_MS ? ANIMATION_DEFAULT_DELAY_MS : (Uint32)delay_cs * 10;
+    return 1;
+}
+
+// Producer side: keeps the ring full, blocking while every slot waits to be shown
+static int animation_decoder_thread(void *data) {
+    AnimationDecoder *decoder = (AnimationDecoder *)data;
+    GifDecoder *gif = &decoder->gif;
+
+    SDL_LockMutex(decoder->lock);
+    while (!decoder->quit) {
+        if (decoder->filled == decoder->ring_size) {
+            SDL_CondWait(decoder->changed, decoder->lock);
+            continue;
+        }
+        AnimationFrame *frame = &decoder->ring[(decoder->head + decoder->filled) % decoder->ring_size];
+        SDL_UnlockMutex(decoder->lock);
+
+        // A frame that fails to decode ends the loop early; one failing from the start ends playback
+        Uint32 delay = 0;
+        int decoded = gif_decode_frame(gif, &delay);
+        if (!decoded && gif->frame_index > 0) {
+            gif_decoder_rewind(gif);
+            decoded = gif_decode_frame(gif, &delay);
+        }
+        int index = gif->frame_index - 1;
+        if (decoded) {
+            SDL_Surface *surface = frame->surface;
+            for (int y = 0; y < gif->height; y++) {
+                memcpy((Uint8 *)surface->pixels + (size_t)y * surface->pitch, gif->canvas + (size_t)y * gif->width,
+                       (size_t)gif->width * sizeof(Uint32));
+            }
+        }
+
+        SDL_LockMutex(decoder->lock);
+        if (!decoded) {
+            decoder->failed = 1;
+            break;
+        }
+        frame->delay_ms = delay;
+        frame->index = index;
+        decoder->filled++;
+    }
+    SDL_UnlockMutex(decoder->lock);
+
+    return 0;
+}
+
+void animation_decoder_destroy(AnimationDecoder *decoder) {
+    if (!decoder) {
+        return;
+    }
+
+    if (decoder->thread) {
+        SDL_LockMutex(decoder->lock);
+        decoder->quit = 1;
+        SDL_CondSignal(decoder->changed);
+        SDL_UnlockMutex(decoder->lock);
+        SDL_WaitThread(decoder->thread, NULL);
+    }
+    for (int i = 0; i < decoder->ring_size; i++) {
+        release_surface(decoder->ring[i].surface);
+    }
+    if (decoder->changed) {
+        SDL_DestroyCond(decoder->changed);
+    }
+    if (decoder->lock) {
+        SDL_DestroyMutex(decoder->lock);
+    }
+    gif_decoder_free(&decoder->gif);
+    unmap_file(&decoder->file);
+    safe_free((void **)&decoder);
+}
+
+// Maps the file and starts decoding ahead when it holds more than one frame
+AnimationDecoder *animation_decoder_create(const char *filepath, PixelPool *pool, int *frame_count) {
+    AnimationDecoder *decoder = NULL;
+    if (safe_malloc((void **)&decoder, sizeof(AnimationDecoder)) != SECURITY_OK) {
+        return NULL;
+    }
+
+    *frame_count = 0;
+    if (map_file(filepath, &decoder->file) != SECURITY_OK) {
+        safe_free((void **)&decoder);
+        return NULL;
+    }
+
+    *frame_count = gif_decoder_init(&decoder->gif, decoder->file.data, decoder->file.size);
+    GifDecoder *gif = &decoder->gif;
+    size_t frame_bytes = (size_t)gif->width * gif->height * sizeof(Uint32);
+    if (*frame_count < 2 ||
+        safe_calloc((void **)&gif->canvas, (size_t)gif->width * gif->height, sizeof(Uint32)) != SECURITY_OK) {
+        animation_decoder_destroy(decoder);
+        return NULL;
+    }
+
+    // Large canvases get a shorter ring, never fewer than two frames
+    decoder->ring_size = (int)SDL_max(2, SDL_min(ANIMATION_RING_FRAMES, ANIMATION_RING_BYTES / frame_bytes));
+    decoder->ring_size = SDL_min(decoder->ring_size, *frame_count);
+    for (int i = 0; i < decoder->ring_size; i++) {
+        decoder->ring[i].surface = pixel_pool_create_surface(pool, gif->width, gif->height, 32,
+                                                             SDL_PIXELFORMAT_ARGB8888);
+        if (!decoder->ring[i].surface) {
+            animation_decoder_destroy(decoder);
+            return NULL;
+        }
+    }
+
+    decoder->lock = SDL_CreateMutex();
+    decoder->changed = SDL_CreateCond();
+    if (!decoder->lock || !decoder->changed) {
+        animation_decoder_destroy(decoder);
+        return NULL;
+    }
+    decoder->thread = SDL_CreateThread(animation_decoder_thread, "photon-animation", decoder);
+    if (!decoder->thread) {
+        animation_decoder_destroy(decoder);
+        return NULL;
+    }
+
+    return decoder;
+}
+
+void animation_player_close(AnimationPlayer *player) {
+    animation_decoder_destroy(player->decoder);
+    if (player->texture) {
+        SDL_DestroyTexture(player->texture);
+    }
+    safe_free((void **)&player->delays);
+    secure_memzero(player, sizeof(AnimationPlayer));
+}
+
+// Starts playback of the image just shown when it is an animated GIF. Other animated formats
+// stay still: SDL_image only offers whole-file animation decoding.
+void animation_player_open(App *app, const char *filepath, const ImageMetadata *metadata) {
+    AnimationPlayer *player = &app->player;
+    if (player->decoder || player->texture) {
+        if (strcmp(player->filepath, filepath) == 0) {
+            return;
+        }
+        animation_player_close(player);
+    }
+    if (!metadata || strcmp(metadata->format, "GIF") != 0) {
+        return;
+    }
+
+    int frame_count = 0;
+    player->decoder = animation_decoder_create(filepath, &app->pixel_pool, &frame_count);
+    if (!player->decoder) {
+        return;
+    }
+
+    int width = player->decoder->gif.width;
+    int height = player->decoder->gif.height;
+    int max_width = app->max_texture_width > 0 ? app->max_texture_width : MAX_IMAGE_DIMENSION;
+    int max_height = app->max_texture_height > 0 ? app->max_texture_height : MAX_IMAGE_DIMENSION;
+
+    // Short, small animations are kept whole in one atlas once their first loop has been decoded
+    int atlas_size = SDL_min(ANIMATION_ATLAS_SIZE, SDL_min(max_width, max_height));
+    int columns = atlas_size / width;
+    int rows = columns > 0 ? (frame_count + columns - 1) / columns : 0;
+    int texture_width = width;
+    int texture_height = height;
+    if (columns > 0 && rows * height <= atlas_size &&
+        safe_calloc((void **)&player->delays, (size_t)frame_count, sizeof(Uint32)) == SECURITY_OK) {
+        player->atlas_columns = columns;
+        texture_width = SDL_min(columns, frame_count) * width;
+        texture_height = rows * height;
+    }
+
+    if (width > max_width || height > max_height ||
+        !(player->texture = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                              texture_width, texture_height))) {
+        animation_player_close(player);
+        return;
+    }
+    SDL_SetTextureBlendMode(player->texture, SDL_BLENDMODE_BLEND);
+
+    secure_strncpy(player->filepath, filepath, sizeof(player->filepath));
+    player->width = width;
+    player->height = height;
+    player->frame_count = frame_count;
+    player->next_frame_at = animation_ticks();
+}
+
+// Playback pauses while the grid or another image is on screen
+static int animation_player_visible(const App *app) {
+    return app->player.texture && !app->grid.active && strcmp(app->player.filepath, app->current_path) == 0;
+}
+
+// Shows the next frame once its predecessor's delay has elapsed
+void animation_player_update(App *app) {
+    AnimationPlayer *player = &app->player;
+    if (!animation_player_visible(app)) {
+        return;
+    }
+
+    Uint64 now = animation_ticks();
+    if (player->frozen || now < player->next_frame_at) {
+        return;
+    }
+
+    Uint32 delay = 0;
+    if (player->decoder) {
+        AnimationDecoder *decoder = player->decoder;
+        SDL_LockMutex(decoder->lock);
+        int available = decoder->filled > 0;
+        int failed = decoder->failed;
+        AnimationFrame *frame = &decoder->ring[decoder->head];
+        SDL_UnlockMutex(decoder->lock);
+
+        if (!available) {
+            if (failed) {
+                // Freeze on the frame shown last; the atlas keeps its cell but is never cycled
+                animation_decoder_destroy(decoder);
+                player->decoder = NULL;
+                player->frozen = 1;
+                player->next_frame_at = ~(Uint64)0;
+                if (!player->has_frame) {
+                    animation_player_close(player);
+                }
+            } else {
+                player->next_frame_at = now + ANIMATION_RETRY_MS;
+            }
+            return;
+        }
+
+        // The slot is not reused by the producer until it is handed back below
+        SDL_Rect rect = {0, 0, player->width, player->height};
+        if (player->atlas_columns > 0) {
+            if (frame->index >= player->frame_count) {
+                frame->index = player->frame_count - 1;
+            }
+            rect.x = (frame->index % player->atlas_columns) * player->width;
+            rect.y = (frame->index / player->atlas_columns) * player->height;
+            player->delays[frame->index] = frame->delay_ms;
+            player->atlas_loaded = SDL_max(player->atlas_loaded, frame->index + 1);
+        }
+        texture_upload_pixels(player->texture, SDL_PIXELFORMAT_ARGB8888, &rect, frame->surface->pixels,
+                              frame->surface->pitch, frame->surface->format->format);
+        player->frame = frame->index;
+        delay = frame->delay_ms;
+
+        SDL_LockMutex(decoder->lock);
+        decoder->head = (decoder->head + 1) % decoder->ring_size;
+        decoder->filled--;
+        SDL_CondSignal(decoder->changed);
+        SDL_UnlockMutex(decoder->lock);
+
+        // With every frame in the atlas the decoder and its ring are no longer needed
+        if (player->atlas_columns > 0 && player->atlas_loaded == player->frame_count) {
+            animation_decoder_destroy(decoder);
+            player->decoder = NULL;
+        }
+    } else if (player->atlas_columns > 0) {
+        player->frame = (player->frame + 1) % player->frame_count;
+        delay = player->delays[player->frame];
+    } else {
+        return;
+    }
+
+    // Deadlines advance from the previous one so delays do not drift; a long stall restarts them
+    player->has_frame = 1;
+    player->next_frame_at += delay;
+    if (player->next_frame_at <= now) {
+        player->next_frame_at = now + delay;
+    }
+    app->needs_redraw = 1;
+}
+
+// Milliseconds the event loop may sleep before the next frame is due
+int animation_player_wait_ms(const App *app) {
+    const AnimationPlayer *player = &app->player;
+    if (!animation_player_visible(app)) {
+        return EVENT_WAIT_TIMEOUT_MS;
+    }
+
+    Uint64 now = animation_ticks();
+    return player->next_frame_at <= now ? 0 : (int)SDL_min(player->next_frame_at - now, (Uint64)EVENT_WAIT_TIMEOUT_MS);
+}
+
+// Draws the current frame in place of the still image; returns 0 when nothing is playing for it
+int render_animation_frame(App *app, const SDL_Rect *dest_rect, const SDL_Rect *viewport) {
+    const AnimationPlayer *player = &app->player;
+    if (!player->has_frame || strcmp(player->filepath, app->current_path) != 0) {
+        return 0;
+    }
+
+    SDL_Rect src = {0, 0, player->width, player->height};
+    if (player->atlas_columns > 0) {
+        src.x = (player->frame % player->atlas_columns) * player->width;
+        src.y = (player->frame / player->atlas_columns) * player->height;
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 12)
+    SDL_SetTextureScaleMode(player->texture, dest_rect->w > player->width * ZOOM_NEAREST_THRESHOLD ?
+                                                 SDL_ScaleModeNearest : SDL_ScaleModeLinear);
+#endif
+    render_copy_clipped(app->renderer, player->texture, &src, dest_rect, viewport, NULL, 1);
+    return 1;
+}
+
+// View functions
+// Size of whatever is on screen: the streaming image while it decodes, else the shown image
+static int view_image_size(const App *app, int *width, int *height) {
+    int orientation = 1;
+    if (app->loading && app->stream_view.source &&
+        strcmp(app->stream_view.source->filepath, app->current_path) == 0) {
+        *width = app->stream_view.source->width;
+        *height = app->stream_view.source->height;
+        orientation = app->stream_view.source->orientation;
+    } else if (app->image) {
+        *width = app->image_width;
+        *height = app->image_height;
+        orientation = app->image_orientation;
+    } else {
+        return 0;
+    }
+
+    // Sizes are as displayed, after any quarter turn
+    if (orientation_swaps_axes(orientation)) {
+        int stored_width = *width;
+        *width = *height;
+        *height = stored_width;
+    }
+    return *width > 0 && *height > 0;
+}
+
+// Magnification on screen, including the one fit-to-window implies
+float effective_zoom(const App *app) {
+    int width, height;
+    if (!app->fit_to_window || !view_image_size(app, &width, &height)) {
+        return app->zoom;
+    }
+    return SDL_min((float)app->window_width / width, (float)app->window_height / height);
+}
+
+// Images smaller than the window stay centred; larger ones may not expose the background
+static float clamp_pan_axis(float pan, float image_extent, int window_extent) {
+    float limit = SDL_max(0.0f, (image_extent - window_extent) / 2.0f);
+    return SDL_max(-limit, SDL_min(pan, limit));
+}
+
+static void clamp_pan(const App *app, float zoom, float *pan_x, float *pan_y) {
+    int width, height;
+    if (!view_image_size(app, &width, &height)) {
+        return;
+    }
+    *pan_x = clamp_pan_axis(*pan_x, width * zoom, app->window_width);
+    *pan_y = clamp_pan_axis(*pan_y, height * zoom, app->window_height);
+}
+
+// Leaves fit-to-window for the equivalent explicit zoom and syncs idle targets to the view
+static void view_begin_change(App *app) {
+    ViewAnimation *animation = &app->animation;
+    if (app->fit_to_window) {
+        app->zoom = effective_zoom(app);
+        app->fit_to_window = 0;
+        app->pan_x = 0.0f;
+        app->pan_y = 0.0f;
+        animation->active = 0;
+    }
+    if (!animation->active) {
+        animation->target_zoom = app->zoom;
+        animation->target_pan_x = app->pan_x;
+        animation->target_pan_y = app->pan_y;
+    }
+}
+
+static void view_start_animation(App *app) {
+    ViewAnimation *animation = &app->animation;
+    if (!animation->active) {
+        animation->active = 1;
+        animation->last_counter = SDL_GetPerformanceCounter();
+        animation->lag_ms = 0.0;
+    }
+    app->needs_redraw = 1;
+}
+
+// Animates toward zoom, keeping the image point under (anchor_x, anchor_y) in place
+void view_zoom_to(App *app, float zoom, int anchor_x, int anchor_y) {
+    int width, height;
+    if (!view_image_size(app, &width, &height)) {
+        return;
+    }
+
+    view_begin_change(app);
+    ViewAnimation *animation = &app->animation;
+    animation->target_zoom = SDL_max(ZOOM_MIN, SDL_min(zoom, ZOOM_MAX));
+    animation->anchor_x = anchor_x - app->window_width / 2.0f;
+    animation->anchor_y = anchor_y - app->window_height / 2.0f;
+    view_start_animation(app);
+}
+
+void view_zoom_by(App *app, float factor, int anchor_x, int anchor_y) {
+    int width, height;
+    if (!view_image_size(app, &width, &height)) {
+        return;
+    }
+
+    view_begin_change(app);
+    view_zoom_to(app, app->animation.target_zoom * factor, anchor_x, anchor_y);
+}
+
+// Drags move the image immediately; key presses glide to the new position
+void view_pan_by(App *app, float dx, float dy, int animate) {
+    int width, height;
+    if (!view_image_size(app, &width, &height)) {
+        return;
+    }
+
+    view_begin_change(app);
+    ViewAnimation *animation = &app->animation;
+    animation->target_pan_x += dx;
+    animation->target_pan_y += dy;
+    clamp_pan(app, animation->target_zoom, &animation->target_pan_x, &animation->target_pan_y);
+    if (animate) {
+        view_start_animation(app);
+        return;
+    }
+
+    app->pan_x += dx;
+    app->pan_y += dy;
+    clamp_pan(app, app->zoom, &app->pan_x, &app->pan_y);
+    app->needs_redraw = 1;
+}
+
+// Back to the centred position with any animation dropped, e.g. for a new image
+void view_reset(App *app, int fit_to_window) {
+    app->fit_to_window = fit_to_window;
+    app->zoom = 1.0f;
+    app->pan_x = 0.0f;
+    app->pan_y = 0.0f;
+    app->animation.active = 0;
+    app->needs_redraw = 1;
+}
+
+static int view_animation_step(App *app) {
+    ViewAnimation *animation = &app->animation;
+    float previous = app->zoom;
+    app->zoom += (animation->target_zoom - app->zoom) * ANIMATION_EASING;
+    if (SDL_fabs(animation->target_zoom - app->zoom) <= animation->target_zoom * 0.001f) {
+        app->zoom = animation->target_zoom;
+    }
+
+    // Scaling about the anchor moves both the current and the target position
+    float ratio = app->zoom / previous;
+    app->pan_x = animation->anchor_x - ratio * (animation->anchor_x - app->pan_x);
+    app->pan_y = animation->anchor_y - ratio * (animation->anchor_y - app->pan_y);
+    animation->target_pan_x = animation->anchor_x - ratio * (animation->anchor_x - animation->target_pan_x);
+    animation->target_pan_y = animation->anchor_y - ratio * (animation->anchor_y - animation->target_pan_y);
+    clamp_pan(app, animation->target_zoom, &animation->target_pan_x, &animation->target_pan_y);
+
+    app->pan_x += (animation->target_pan_x - app->pan_x) * ANIMATION_EASING;
+    app->pan_y += (animation->target_pan_y - app->pan_y) * ANIMATION_EASING;
+    clamp_pan(app, app->zoom, &app->pan_x, &app->pan_y);
+
+    if (app->zoom == animation->target_zoom && SDL_fabs(animation->target_pan_x - app->pan_x) < 0.5 &&
+        SDL_fabs(animation->target_pan_y - app->pan_y) < 0.5) {
+        app->pan_x = animation->target_pan_x;
+        app->pan_y = animation->target_pan_y;
+        return 0;
+    }
+    return 1;
+}
+
+// Runs the fixed steps that fit in the time since the last call; requests a frame only
+// when the view actually moved. Returns whether the animation is still running.
+int update_view_animation(App *app) {
+    ViewAnimation *animation = &app->animation;
+    if (!animation->active) {
+        return 0;
+    }
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    animation->lag_ms += (double)(now - animation->last_counter) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    animation->last_counter = now;
+
+    int steps = (int)(animation->lag_ms / ANIMATION_STEP_MS);
+    if (steps > ANIMATION_MAX_STEPS) {
+        steps = ANIMATION_MAX_STEPS;
+        animation->lag_ms = 0.0;
+    } else {
+        animation->lag_ms -= steps * ANIMATION_STEP_MS;
+    }
+
+    for (int i = 0; i < steps && animation->active; i++) {
+        animation->active = view_animation_step(app);
+    }
+    if (steps > 0) {
+        app->needs_redraw = 1;
+    }
+    return animation->active;
+}
+
+// Zooming or resizing past the native scale of a reduced decode fetches the full image,
+// which replaces it on arrival
+void view_check_resolution(App *app) {
+    if (!app->image_reduced || app->upgrade_requested || app->loading || !app->image) {
+        return;
+    }
+
+    const TiledTexture *native = &app->image->levels[0];
+    float zoom = effective_zoom(app);
+    if (zoom * app->image->width <= native->width + 1.0f && zoom * app->image->height <= native->height + 1.0f) {
+        return;
+    }
+
+    app->upgrade_requested = 1;
+    image_loader_upgrade(app);
+}
+
+// Directory navigation functions
+void directory_index_free(DirectoryIndex *index) {
+    if (!index) {
+        return;
+    }
+
+    for (int i = 0; i < index->count; i++) {
+        safe_free((void **)&index->files[i]);
+    }
+    free(index->files);
+    secure_memzero(index, sizeof(DirectoryIndex));
+}
+
+static int directory_index_add(DirectoryIndex *index, const char *name) {
+    if (index->count == index->capacity) {
+        int capacity = index->capacity ? index->capacity * 2 : 64;
+        char **files = (char **)realloc(index->files, (size_t)capacity * sizeof(char *));
+        if (!files) {
+            return 0;
+        }
+        index->files = files;
+        index->capacity = capacity;
+    }
+
+    size_t len = strlen(name) + 1;
+    char *copy = NULL;
+    if (safe_malloc_uninitialized((void **)&copy, len) != SECURITY_OK) {
+        return 0;
+    }
+    memcpy(copy, name, len);
+    index->files[index->count++] = copy;
+    return 1;
+}
+
+static int compare_filenames(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static int join_path(char *out, size_t out_size, const char *directory, const char *name) {
+    size_t dir_len = strlen(directory);
+    const char *separator = "";
+    if (dir_len > 0 && directory[dir_len - 1] != '/' && directory[dir_len - 1] != '\\') {
+        separator = "/";
+    }
+
+    int written = snprintf(out, out_size, "%s%s%s", directory, separator, name);
+    return written > 0 && (size_t)written < out_size;
+}
+
+int directory_index_path(const DirectoryIndex *index, int position, char *out, size_t out_size) {
+    if (!index || position < 0 || position >= index->count || !out || out_size == 0) {
+        return 0;
+    }
+
+    return join_path(out, out_size, index->directory, index->files[position]);
+}
+
+// Lists the images in index->directory in name order
+static int directory_index_list(DirectoryIndex *index) {
+    DIR *dir = opendir(index->directory[0] != '\0' ? index->directory : ".");
+    if (!dir) {
+        return 0;
+    }
+
+    struct dirent *dirent_entry;
+    while ((dirent_entry = readdir(dir)) != NULL) {
+        const char *name = dirent_entry->d_name;
+        if (name[0] == '.' || strcmp(get_format_name(name), "Unknown") == 0) {
+            continue;
+        }
+
+        char path[MAX_PATH_LENGTH];
+        struct stat file_stat;
+        if (!join_path(path, sizeof(path), index->directory, name)) {
+            continue;
+        }
+        if (stat(path, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+            continue;
+        }
+
+        if (!directory_index_add(index, name)) {
+            break;
+        }
+    }
+    closedir(dir);
+
+    qsort(index->files, (size_t)index->count, sizeof(char *), compare_filenames);
+    return 1;
+}
+
+// Indexes a folder directly, with no image selected yet
+int directory_index_open(DirectoryIndex *index, const char *directory) {
+    if (!index || !directory || validate_filepath(directory) != SECURITY_OK) {
+        return 0;
+    }
+
+    directory_index_free(index);
+    index->current = -1;
+    secure_strncpy(index->directory, directory, sizeof(index->directory));
+    return directory_index_list(index);
+}
+
+// Scans the folder containing image_path once and positions the index on that file
+int directory_index_scan(DirectoryIndex *index, const char *image_path) {
+    if (!index || !image_path || validate_filepath(image_path) != SECURITY_OK) {
+        return 0;
+    }
+
+    directory_index_free(index);
+    index->current = -1;
+
+    const char *filename = strrchr(image_path, '/');
+    const char *backslash = strrchr(image_path, '\\');
+    if (backslash && (!filename || backslash > filename)) {
+        filename = backslash;
+    }
+
+    if (filename) {
+        size_t dir_len = (size_t)(filename - image_path);
+        if (dir_len == 0) {
+            dir_len = 1; // File in the root directory
+        }
+        if (dir_len >= sizeof(index->directory)) {
+            return 0;
+        }
+        memcpy(index->directory, image_path, dir_len);
+        index->directory[dir_len] = '\0';
+        filename++;
+    } else {
+        filename = image_path;
+    }
+
+    if (!directory_index_list(index)) {
+        return 0;
+    }
+
+    for (int i = 0; i < index->count; i++) {
+        if (strcmp(index->files[i], filename) == 0) {
+            index->current = i;
+            break;
+        }
+    }
+
+    return 1;
+}
+
+// Position of name in the sorted index, or where it would be inserted when *found is 0
+int directory_index_find(const DirectoryIndex *index, const char *name, int *found) {
+    int low = 0;
+    int high = index->count;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        int order = strcmp(index->files[mid], name);
+        if (order == 0) {
+            *found = 1;
+            return mid;
+        }
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = 0;
+    return low;
+}
+
+// Inserts name at position, keeping current on the same file
+int directory_index_insert(DirectoryIndex *index, int position, const char *name) {
+    if (!directory_index_add(index, name)) {
+        return 0;
+    }
+    char *added = index->files[index->count - 1];
+    memmove(&index->files[position + 1], &index->files[position],
+            (size_t)(index->count - 1 - position) * sizeof(char *));
+    index->files[position] = added;
+    if (index->current >= position) {
+        index->current++;
+    } else if (index->current < 0 && position < index->gap - 1) {
+        index->gap++;
+    }
+    return 1;
+}
+
+// Removing the current file leaves no current position, only the gap it left, so browsing
+// carries on from its neighbours; what is on screen stays up
+void directory_index_remove(DirectoryIndex *index, int position) {
+    safe_free((void **)&index->files[position]);
+    memmove(&index->files[position], &index->files[position + 1],
+            (size_t)(index->count - 1 - position) * sizeof(char *));
+    index->count--;
+    if (index->current == position) {
+        index->current = -1;
+        index->gap = position + 1;
+    } else if (index->current > position) {
+        index->current--;
+    } else if (index->current < 0 && position < index->gap - 1) {
+        index->gap--;
+    }
+}
+
+static int directory_index_wrap(const DirectoryIndex *index, int position) {
+    position %= index->count;
+    return position < 0 ? position + index->count : position;
+}
+
+// Where a step lands; from a gap, the file after it is one step forward and the one before it
+// one step back. With no position at all it starts at the first file.
+static int directory_index_step(const DirectoryIndex *index, int step) {
+    if (index->current >= 0) {
+        return directory_index_wrap(index, index->current + step);
+    }
+    if (index->gap == 0) {
+        return 0;
+    }
+    return directory_index_wrap(index, index->gap - 1 + (step > 0 ? step - 1 : step));
+}
+
+void schedule_prefetch(App *app) {
+    DirectoryIndex *index = &app->directory;
+    if (index->count <= 1 || index->current < 0) {
+        return;
+    }
+
+    // Nearest neighbours first, the browsing direction before the one behind
+    char paths[PREFETCH_RADIUS * 2][MAX_PATH_LENGTH];
+    int count = 0;
+    int forward = index->direction < 0 ? -1 : 1;
+    for (int distance = 1; distance <= PREFETCH_RADIUS; distance++) {
+        for (int pass = 0; pass < 2; pass++) {
+            int sign = pass == 0 ? forward : -forward;
+            int position = directory_index_wrap(index, index->current + sign * distance);
+            if (position == index->current ||
+                !directory_index_path(index, position, paths[count], sizeof(paths[count]))) {
+                continue;
+            }
+            if (texture_cache_find(app, paths[count])) {
+                continue;
+            }
+
+            int duplicate = 0;
+            for (int i = 0; i < count; i++) {
+                duplicate |= strcmp(paths[i], paths[count]) == 0;
+            }
+            if (!duplicate) {
+                count++;
+            }
+        }
+    }
+
+    image_loader_prefetch(app, paths, count);
+}
+
+int show_image(App *app, const char *image_path) {
+    TextureCacheEntry *entry = texture_cache_find(app, image_path);
+    if (entry) {
+        secure_strncpy(app->current_path, image_path, sizeof(app->current_path));
+        app->loading = 0;
+        show_cache_entry(app, entry);
+        animation_player_open(app, image_path, &entry->metadata);
+        schedule_prefetch(app);
+        return 1;
+    }
+
+    return load_image(app, image_path);
+}
+
+void navigate_directory(App *app, int step) {
+    DirectoryIndex *index = &app->directory;
+    if (index->count == 0) {
+        return;
+    }
+
+    int position = directory_index_step(index, step);
+    char path[MAX_PATH_LENGTH];
+    if (!directory_index_path(index, position, path, sizeof(path))) {
+        return;
+    }
+
+    index->current = position;
+    if (step != 0) {
+        index->direction = step > 0 ? 1 : -1;
+    }
+    view_reset(app, app->fit_to_window);
+    show_image(app, path);
+}
+
+// Stream view functions
+void stream_view_reset(StreamView *view) {
+    if (view->preview) {
+        SDL_DestroyTexture(view->preview);
+    }
+    if (view->rows) {
+        SDL_DestroyTexture(view->rows);
+    }
+    secure_memzero(view, sizeof(StreamView));
+}
+
+// Uploads whatever the loader has decoded since the last progress event
+void update_stream_view(App *app, ProgressiveImage *stream) {
+    SDL_AtomicSet(&stream->notify_pending, 0);
+    if (!app->loading || strcmp(stream->filepath, app->current_path) != 0) {
+        return;
+    }
+
+    StreamView *view = &app->stream_view;
+    if (view->source != stream) {
+        stream_view_reset(view);
+        view->source = stream;
+    }
+
+    SDL_LockMutex(stream->lock);
+    if (stream->preview && !view->preview) {
+        view->preview = SDL_CreateTextureFromSurface(app->renderer, stream->preview);
+    }
+
+    // Rows are skipped when the frame needs tiling; the preview alone covers those
+    SDL_Surface *surface = stream->surface;
+    if (surface && (app->max_texture_width <= 0 || surface->w <= app->max_texture_width) &&
+        (app->max_texture_height <= 0 || surface->h <= app->max_texture_height)) {
+        if (!view->rows) {
+            view->rows_format = choose_texture_format(&app->texture_formats, surface);
+            if (view->rows_format == SDL_PIXELFORMAT_UNKNOWN) {
+                view->rows_format = surface->format->format;
+            }
+            view->rows = SDL_CreateTexture(app->renderer, view->rows_format, SDL_TEXTUREACCESS_STREAMING,
+                                           surface->w, surface->h);
+        }
+        if (view->rows && stream->dirty_bottom > stream->dirty_top) {
+            SDL_Rect rows = {0, stream->dirty_top, surface->w, stream->dirty_bottom - stream->dirty_top};
+            const Uint8 *pixels = (const Uint8 *)surface->pixels + (size_t)rows.y * surface->pitch;
+            if (texture_upload_pixels(view->rows, view->rows_format, &rows, pixels, surface->pitch,
+                                      surface->format->format)) {
+                view->rows_visible = stream->rows_visible;
+            }
+        }
+    }
+    stream->dirty_top = 0;
+    stream->dirty_bottom = 0;
+    SDL_UnlockMutex(stream->lock);
+
+    app->needs_redraw = 1;
+}
+
+void complete_image_load(App *app, LoadResult *load) {
+    if (!app || !load) {
+        return;
+    }
+
+    if (load->stream && app->stream_view.source == load->stream) {
+        stream_view_reset(&app->stream_view);
+    }
+
+    // Stages that did not run are left out rather than counted as free
+    for (int stage = 0; stage < STATS_STAGE_UPLOAD; stage++) {
+        if (load->stage_ms[stage] > 0.0) {
+            stats_record(&app->stats, (StatsStage)stage, load->stage_ms[stage]);
+        }
+    }
+
+    TextureCacheEntry *entry = NULL;
+    SecurityResult result = load->result;
+    if (result == SECURITY_OK) {
+        Uint64 start = SDL_GetPerformanceCounter();
+        result = upload_image_surface(app, load->filepath, load->levels, load->level_count, load->full_width,
+                                      load->full_height, &load->metadata, &entry);
+        stats_record(&app->stats, STATS_STAGE_UPLOAD, stats_elapsed_ms(start));
+    }
+
+    // A prefetch that is over budget even with every other texture evicted is not kept
+    if (entry && load->prefetch && app->cache.bytes > app->memory.gpu_cap && &entry->image != app->image &&
+        strcmp(load->filepath, app->current_path) != 0) {
+        texture_cache_release(&app->cache, entry);
+        app->memory.evictions++;
+        entry = NULL;
+    }
+    if (entry) {
+        entry->reduced = load->reduced;
+    }
+    if (entry && load->skipped_levels > 0) {
+        app->memory.downscaled++;
+        SDL_Log("Over GPU budget: %s kept at 1/%d size", load->filepath, 1 << load->skipped_levels);
+    }
+
+    // Only the image the user is waiting on is shown; prefetches just land in the cache
+    if (app->loading && strcmp(load->filepath, app->current_path) == 0) {
+        app->loading = 0;
+        app->needs_redraw = 1;
+        if (entry) {
+            show_cache_entry(app, entry);
+            animation_player_open(app, load->filepath, &entry->metadata);
+        }
+
+        if (report_load_result(app, load->filepath, result)) {
+            schedule_prefetch(app);
+        } else {
+            SDL_Log("Failed to load image. Keeping current view.");
+        }
+    } else if (entry && !entry->reduced && app->image_reduced && strcmp(load->filepath, app->current_path) == 0) {
+        // Full-size decode replacing the reduced one on screen, keeping the view as it is
+        ImagePyramid *reduced = app->image;
+        show_cache_entry(app, entry);
+        for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+            if (&app->cache.entries[i].image == reduced) {
+                texture_cache_release(&app->cache, &app->cache.entries[i]);
+            }
+        }
+    } else if (result != SECURITY_OK && load->prefetch) {
+        SDL_Log("Prefetch failed: %s", load->filepath);
+    }
+
+    load_result_free(load);
+}
+
+// Text rendering functions
+// 8x16 monochrome glyphs for ASCII 32-126, one byte per row with the MSB on the left.
+// Drawn for Photon; the shapes loosely follow a typical sans-serif monospace face.
+static const Uint8 font_glyphs[GLYPH_COUNT][GLYPH_HEIGHT] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, // '!'
+    {0x00, 0x00, 0x00, 0x28, 0x28, 0x28, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '"'
+    {0x00, 0x00, 0x00, 0x24, 0x24, 0x7E, 0x24, 0x24, 0x24, 0x7E, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00}, // '#'
+    {0x00, 0x00, 0x00, 0x08, 0x3E, 0x49, 0x48, 0x38, 0x0E, 0x09, 0x49, 0x3E, 0x08, 0x08, 0x00, 0x00}, // '$'
+    {0x00, 0x00, 0x00, 0x60, 0x90, 0x90, 0x62, 0x1C, 0x66, 0x09, 0x09, 0x06, 0x00, 0x00, 0x00, 0x00}, // '%'
+    {0x00, 0x00, 0x00, 0x1C, 0x20, 0x20, 0x30, 0x49, 0x4D, 0x45, 0x62, 0x3D, 0x00, 0x00, 0x00, 0x00}, // '&'
+    {0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '\''
+    {0x00, 0x0C, 0x08, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x08, 0x08, 0x04, 0x00, 0x00, 0x00}, // '('
+    {0x00, 0x30, 0x10, 0x10, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x10, 0x10, 0x30, 0x00, 0x00, 0x00}, // ')'
+    {0x00, 0x00, 0x00, 0x08, 0x49, 0x3E, 0x1C, 0x6B, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '*'
+    {0x00, 0x00, 0x00, 0x00, 0x10, 0x10, 0x10, 0xFE, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00}, // '+'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00, 0x00}, // ','
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x38, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '-'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, // '.'
+    {0x00, 0x00, 0x00, 0x02, 0x04, 0x04, 0x08, 0x08, 0x18, 0x10, 0x10, 0x20, 0x20, 0x40, 0x00, 0x00}, // '/'
+    {0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x41, 0x49, 0x41, 0x41, 0x22, 0x1C, 0x00, 0x00, 0x00, 0x00}, // '0'
+    {0x00, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x3E, 0x00, 0x00, 0x00, 0x00}, // '1'
+    {0x00, 0x00, 0x00, 0x3E, 0x43, 0x01, 0x01, 0x02, 0x0C, 0x18, 0x20, 0x7F, 0x00, 0x00, 0x00, 0x00}, // '2'
+    {0x00, 0x00, 0x00, 0x3E, 0x41, 0x01, 0x03, 0x1C, 0x03, 0x01, 0x43, 0x3E, 0x00, 0x00, 0x00, 0x00}, // '3'
+    {0x00, 0x00, 0x00, 0x06, 0x0A, 0x1A, 0x12, 0x22, 0x42, 0x7F, 0x02, 0x02, 0x00, 0x00, 0x00, 0x00}, // '4'
+    {0x00, 0x00, 0x00, 0x7E, 0x40, 0x40, 0x7C, 0x03, 0x01, 0x01, 0x43, 0x3C, 0x00, 0x00, 0x00, 0x00}, // '5'
+    {0x00, 0x00, 0x00, 0x1E, 0x21, 0x40, 0x5E, 0x63, 0x41, 0x41, 0x23, 0x1E, 0x00, 0x00, 0x00, 0x00}, // '6'
+    {0x00, 0x00, 0x00, 0x7F, 0x02, 0x02, 0x04, 0x04, 0x08, 0x18, 0x10, 0x20, 0x00, 0x00, 0x00, 0x00}, // '7'
+    {0x00, 0x00, 0x00, 0x3E, 0x41, 0x41, 0x41, 0x3E, 0x63, 0x41, 0x61, 0x3E, 0x00, 0x00, 0x00, 0x00}, // '8'
+    {0x00, 0x00, 0x00, 0x3C, 0x62, 0x41, 0x41, 0x63, 0x3D, 0x01, 0x42, 0x3C, 0x00, 0x00, 0x00, 0x00}, // '9'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, // ':'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x18, 0x00, 0x00, 0x00, 0x18, 0x18, 0x10, 0x20, 0x00, 0x00}, // ';'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x0E, 0x70, 0x70, 0x0E, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00}, // '<'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x00, 0x00, 0x7F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '='
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x40, 0x38, 0x07, 0x07, 0x38, 0x40, 0x00, 0x00, 0x00, 0x00, 0x00}, // '>'
+    {0x00, 0x00, 0x00, 0x38, 0x44, 0x04, 0x08, 0x10, 0x10, 0x00, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, // '?'
+    {0x00, 0x00, 0x00, 0x1E, 0x33, 0x21, 0x47, 0x49, 0x49, 0x49, 0x47, 0x20, 0x30, 0x1E, 0x00, 0x00}, // '@'
+    {0x00, 0x00, 0x00, 0x08, 0x14, 0x14, 0x14, 0x22, 0x22, 0x3E, 0x63, 0x41, 0x00, 0x00, 0x00, 0x00}, // 'A'
+    {0x00, 0x00, 0x00, 0x7E, 0x41, 0x41, 0x41, 0x7E, 0x41, 0x41, 0x41, 0x7E, 0x00, 0x00, 0x00, 0x00}, // 'B'
+    {0x00, 0x00, 0x00, 0x1E, 0x21, 0x40, 0x40, 0x40, 0x40, 0x40, 0x21, 0x1E, 0x00, 0x00, 0x00, 0x00}, // 'C'
+    {0x00, 0x00, 0x00, 0x7C, 0x42, 0x41, 0x41, 0x41, 0x41, 0x41, 0x42, 0x7C, 0x00, 0x00, 0x00, 0x00}, // 'D'
+    {0x00, 0x00, 0x00, 0x7F, 0x40, 0x40, 0x40, 0x7F, 0x40, 0x40, 0x40, 0x7F, 0x00, 0x00, 0x00, 0x00}, // 'E'
+    {0x00, 0x00, 0x00, 0x7F, 0x40, 0x40, 0x40, 0x7F, 0x40, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00}, // 'F'
+    {0x00, 0x00, 0x00, 0x1E, 0x21, 0x40, 0x40, 0x43, 0x41, 0x41, 0x21, 0x1E, 0x00, 0x00, 0x00, 0x00}, // 'G'
+    {0x00, 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x7F, 0x41, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00}, // 'H'
+    {0x00, 0x00, 0x00, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00, 0x00}, // 'I'
+    {0x00, 0x00, 0x00, 0x1C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x44, 0x38, 0x00, 0x00, 0x00, 0x00}, // 'J'
+    {0x00, 0x00, 0x00, 0x42, 0x44, 0x48, 0x50, 0x70, 0x48, 0x44, 0x44, 0x42, 0x00, 0x00, 0x00, 0x00}, // 'K'
+    {0x00, 0x00, 0x00, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x40, 0x7F, 0x00, 0x00, 0x00, 0x00}, // 'L'
+    {0x00, 0x00, 0x00, 0x63, 0x63, 0x55, 0x55, 0x55, 0x49, 0x41, 0x41, 0x41, 0x00, 0x00, 0x00, 0x00}, // 'M'
+    {0x00, 0x00, 0x00, 0x61, 0x61, 0x51, 0x51, 0x49, 0x45, 0x45, 0x43, 0x43, 0x00, 0x00, 0x00, 0x00}, // 'N'
+    {0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x22, 0x1C, 0x00, 0x00, 0x00, 0x00}, // 'O'
+    {0x00, 0x00, 0x00, 0x7E, 0x43, 0x41, 0x41, 0x43, 0x7E, 0x40, 0x40, 0x40, 0x00, 0x00, 0x00, 0x00}, // 'P'
+    {0x00, 0x00, 0x00, 0x1C, 0x22, 0x41, 0x41, 0x41, 0x41, 0x41, 0x23, 0x1E, 0x06, 0x02, 0x00, 0x00}, // 'Q'
+    {0x00, 0x00, 0x00, 0x7E, 0x43, 0x41, 0x41, 0x7E, 0x48, 0x44, 0x42, 0x41, 0x00, 0x00, 0x00, 0x00}, // 'R'
+    {0x00, 0x00, 0x00, 0x3E, 0x61, 0x40, 0x60, 0x3E, 0x03, 0x01, 0x43, 0x3E, 0x00, 0x00, 0x00, 0x00}, // 'S'
+    {0x00, 0x00, 0x00, 0xFE, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, // 'T'
+    {0x00, 0x00, 0x00, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x41, 0x3E, 0x00, 0x00, 0x00, 0x00}, // 'U'
+    {0x00, 0x00, 0x00, 0x41, 0x63, 0x22, 0x22, 0x22, 0x14, 0x14, 0x14, 0x08, 0x00, 0x00, 0x00, 0x00}, // 'V'
+    {0x00, 0x00, 0x00, 0x81, 0x81, 0x81, 0x5A, 0x5A, 0x5A, 0x66, 0x66, 0x66, 0x00, 0x00, 0x00, 0x00}, // 'W'
+    {0x00, 0x00, 0x00, 0x63, 0x22, 0x14, 0x1C, 0x08, 0x14, 0x36, 0x22, 0x41, 0x00, 0x00, 0x00, 0x00}, // 'X'
+    {0x00, 0x00, 0x00, 0x82, 0x44, 0x28, 0x28, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, // 'Y'
+    {0x00, 0x00, 0x00, 0x7F, 0x03, 0x06, 0x04, 0x08, 0x10, 0x30, 0x60, 0x7F, 0x00, 0x00, 0x00, 0x00}, // 'Z'
+    {0x00, 0x1C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1C, 0x00, 0x00, 0x00}, // '['
+    {0x00, 0x00, 0x00, 0x40, 0x20, 0x20, 0x10, 0x10, 0x18, 0x08, 0x08, 0x04, 0x04, 0x02, 0x00, 0x00}, // '\\'
+    {0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x38, 0x00, 0x00, 0x00}, // ']'
+    {0x00, 0x00, 0x00, 0x10, 0x28, 0x44, 0xC6, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '^'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0x00}, // '_'
+    {0x00, 0x00, 0x10, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '`'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x02, 0x3E, 0x42, 0x46, 0x3A, 0x00, 0x00, 0x00, 0x00}, // 'a'
+    {0x00, 0x40, 0x40, 0x40, 0x40, 0x7C, 0x66, 0x42, 0x42, 0x42, 0x66, 0x7C, 0x00, 0x00, 0x00, 0x00}, // 'b'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x1C, 0x22, 0x40, 0x40, 0x40, 0x22, 0x1C, 0x00, 0x00, 0x00, 0x00}, // 'c'
+    {0x00, 0x02, 0x02, 0x02, 0x02, 0x3E, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3E, 0x00, 0x00, 0x00, 0x00}, // 'd'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x66, 0x42, 0x7E, 0x40, 0x62, 0x3C, 0x00, 0x00, 0x00, 0x00}, // 'e'
+    {0x00, 0x0C, 0x10, 0x10, 0x10, 0x7C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00, 0x00, 0x00}, // 'f'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3A, 0x02, 0x22, 0x1C, 0x00}, // 'g'
+    {0x00, 0x40, 0x40, 0x40, 0x40, 0x5C, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, // 'h'
+    {0x00, 0x10, 0x00, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x7C, 0x00, 0x00, 0x00, 0x00}, // 'i'
+    {0x00, 0x08, 0x00, 0x00, 0x00, 0x38, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x08, 0x70, 0x00}, // 'j'
+    {0x00, 0x40, 0x40, 0x40, 0x40, 0x44, 0x48, 0x50, 0x70, 0x48, 0x44, 0x42, 0x00, 0x00, 0x00, 0x00}, // 'k'
+    {0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0E, 0x00, 0x00, 0x00, 0x00}, // 'l'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7F, 0x49, 0x49, 0x49, 0x49, 0x49, 0x49, 0x00, 0x00, 0x00, 0x00}, // 'm'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x5C, 0x62, 0x42, 0x42, 0x42, 0x42, 0x42, 0x00, 0x00, 0x00, 0x00}, // 'n'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3C, 0x00, 0x00, 0x00, 0x00}, // 'o'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7C, 0x66, 0x42, 0x42, 0x42, 0x66, 0x7C, 0x40, 0x40, 0x40, 0x00}, // 'p'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3E, 0x66, 0x42, 0x42, 0x42, 0x66, 0x3A, 0x02, 0x02, 0x02, 0x00}, // 'q'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x32, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00}, // 'r'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x3C, 0x42, 0x40, 0x3C, 0x02, 0x42, 0x3C, 0x00, 0x00, 0x00, 0x00}, // 's'
+    {0x00, 0x00, 0x00, 0x10, 0x10, 0x7E, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0E, 0x00, 0x00, 0x00, 0x00}, // 't'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x42, 0x42, 0x42, 0x42, 0x46, 0x3A, 0x00, 0x00, 0x00, 0x00}, // 'u'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x66, 0x24, 0x24, 0x3C, 0x18, 0x18, 0x00, 0x00, 0x00, 0x00}, // 'v'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x81, 0x81, 0x5A, 0x5A, 0x5A, 0x24, 0x24, 0x00, 0x00, 0x00, 0x00}, // 'w'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x66, 0x24, 0x18, 0x18, 0x18, 0x24, 0x66, 0x00, 0x00, 0x00, 0x00}, // 'x'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x42, 0x22, 0x24, 0x24, 0x14, 0x18, 0x08, 0x08, 0x10, 0x30, 0x00}, // 'y'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x7E, 0x02, 0x04, 0x18, 0x20, 0x40, 0x7E, 0x00, 0x00, 0x00, 0x00}, // 'z'
+    {0x00, 0x1C, 0x10, 0x10, 0x10, 0x10, 0x60, 0x10, 0x10, 0x10, 0x10, 0x10, 0x0C, 0x00, 0x00, 0x00}, // '{'
+    {0x00, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x00, 0x00}, // '|'
+    {0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x0C, 0x10, 0x10, 0x10, 0x10, 0x10, 0x60, 0x00, 0x00, 0x00}, // '}'
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x46, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // '~'
+};
+
+void glyph_atlas_destroy(GlyphAtlas *atlas) {
+    if (!atlas) {
+        return;
+    }
+
+    if (atlas->texture) {
+        SDL_DestroyTexture(atlas->texture);
+    }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    free(atlas->vertices);
+    free(atlas->indices);
+#endif
+    secure_memzero(atlas, sizeof(GlyphAtlas));
+}
+
+int glyph_atlas_create(SDL_Renderer *renderer, GlyphAtlas *atlas) {
+    if (!renderer || !atlas) {
+        return 0;
+    }
+
+    secure_memzero(atlas, sizeof(GlyphAtlas));
+
+    int rows = (GLYPH_COUNT + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, GLYPH_ATLAS_COLUMNS * GLYPH_WIDTH,
+                                                          rows * GLYPH_HEIGHT, 32, SDL_PIXELFORMAT_ARGB8888);
+    if (!surface) {
+        return 0;
+    }
+
+    // White glyphs on transparent black; color comes from the vertices
+    SDL_FillRect(surface, NULL, 0);
+    for (int glyph = 0; glyph < GLYPH_COUNT; glyph++) {
+        int cell_x = (glyph % GLYPH_ATLAS_COLUMNS) * GLYPH_WIDTH;
+        int cell_y = (glyph / GLYPH_ATLAS_COLUMNS) * GLYPH_HEIGHT;
+        for (int y = 0; y < GLYPH_HEIGHT; y++) {
+            Uint32 *row = (Uint32 *)((Uint8 *)surface->pixels + (size_t)(cell_y + y) * surface->pitch);
+            for (int x = 0; x < GLYPH_WIDTH; x++) {
+                if (font_glyphs[glyph][y] & (0x80 >> x)) {
+                    row[cell_x + x] = 0xFFFFFFFF;
+                }
+            }
+        }
+    }
+
+    atlas->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_FreeSurface(surface);
+    if (!atlas->texture) {
+        return 0;
+    }
+    SDL_SetTextureBlendMode(atlas->texture, SDL_BLENDMODE_BLEND);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    atlas->vertices = (SDL_Vertex *)calloc(GLYPH_BATCH_CAPACITY * 4, sizeof(SDL_Vertex));
+    atlas->indices = (int *)calloc(GLYPH_BATCH_CAPACITY * 6, sizeof(int));
+    if (!atlas->vertices || !atlas->indices) {
+        glyph_atlas_destroy(atlas);
+        return 0;
+    }
+
+    // Two triangles per glyph quad; the pattern never changes
+    for (int i = 0; i < GLYPH_BATCH_CAPACITY; i++) {
+        int *quad = &atlas->indices[i * 6];
+        quad[0] = i * 4;
+        quad[1] = i * 4 + 1;
+        quad[2] = i * 4 + 2;
+        quad[3] = i * 4 + 2;
+        quad[4] = i * 4 + 3;
+        quad[5] = i * 4;
+    }
+#endif
+
+    return 1;
+}
+
+void flush_text(SDL_Renderer *renderer, GlyphAtlas *atlas) {
+    if (!renderer || !atlas || !atlas->texture || atlas->glyph_count == 0) {
+        return;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_RenderGeometry(renderer, atlas->texture, atlas->vertices, atlas->glyph_count * 4,
+                       atlas->indices, atlas->glyph_count * 6);
+#endif
+    atlas->glyph_count = 0;
+}
+
+// Queues at most max_chars glyphs of text with its top-left corner at (x, y)
+void queue_text(SDL_Renderer *renderer, GlyphAtlas *atlas, int x, int y, const char *text,
+                int max_chars, SDL_Color color) {
+    if (!renderer || !atlas || !atlas->texture || !text) {
+        return;
+    }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    float atlas_width = (float)(GLYPH_ATLAS_COLUMNS * GLYPH_WIDTH);
+    float atlas_height = (float)(((GLYPH_COUNT + GLYPH_ATLAS_COLUMNS - 1) / GLYPH_ATLAS_COLUMNS) * GLYPH_HEIGHT);
+#else
+    SDL_SetTextureColorMod(atlas->texture, color.r, color.g, color.b);
+#endif
+
+    for (int i = 0; text[i] != '\0' && i < max_chars; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (c == ' ') {
+            continue;
+        }
+        if (c < GLYPH_FIRST || c >= GLYPH_FIRST + GLYPH_COUNT) {
+            c = '?';
+        }
+
+        int glyph = c - GLYPH_FIRST;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        if (atlas->glyph_count == GLYPH_BATCH_CAPACITY) {
+            flush_text(renderer, atlas);
+        }
+
+        float u0 = (glyph % GLYPH_ATLAS_COLUMNS) * GLYPH_WIDTH / atlas_width;
+        float v0 = (glyph / GLYPH_ATLAS_COLUMNS) * GLYPH_HEIGHT / atlas_height;
+        float u1 = u0 + GLYPH_WIDTH / atlas_width;
+        float v1 = v0 + GLYPH_HEIGHT / atlas_height;
+        float x0 = (float)(x + i * GLYPH_WIDTH);
+        float y0 = (float)y;
+        float x1 = x0 + GLYPH_WIDTH;
+        float y1 = y0 + GLYPH_HEIGHT;
+
+        SDL_Vertex *quad = &atlas->vertices[atlas->glyph_count * 4];
+        quad[0] = (SDL_Vertex){{x0, y0}, color, {u0, v0}};
+        quad[1] = (SDL_Vertex){{x1, y0}, color, {u1, v0}};
+        quad[2] = (SDL_Vertex){{x1, y1}, color, {u1, v1}};
+        quad[3] = (SDL_Vertex){{x0, y1}, color, {u0, v1}};
+        atlas->glyph_count++;
+#else
+        SDL_Rect src = {(glyph % GLYPH_ATLAS_COLUMNS) * GLYPH_WIDTH, (glyph / GLYPH_ATLAS_COLUMNS) * GLYPH_HEIGHT,
+                        GLYPH_WIDTH, GLYPH_HEIGHT};
+        SDL_Rect dest = {x + i * GLYPH_WIDTH, y, GLYPH_WIDTH, GLYPH_HEIGHT};
+        SDL_RenderCopy(renderer, atlas->texture, &src, &dest);
+#endif
+    }
+}
+
+void update_overlay_text(App *app, const ImageMetadata *metadata) {
+    OverlayText *text = &app->overlay_text;
+    if (text->valid && text->metadata_version == app->metadata_version && text->zoom == app->zoom) {
+        return;
+    }
+
+    int line_count = 0;
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "File: %s", metadata->filename);
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Format: %s", metadata->format);
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Dimensions: %dx%d",
+             metadata->width, metadata->height);
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Size: %s",
+             format_file_size(metadata->file_size));
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Color Depth: %d bpp",
+             metadata->bits_per_pixel);
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Color: %s",
+             metadata->color_space[0] ? metadata->color_space : "untagged (sRGB)");
+    if (metadata->camera_make[0] || metadata->camera_model[0]) {
+        snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Camera: %s%s%s", metadata->camera_make,
+                 metadata->camera_make[0] && metadata->camera_model[0] ? " " : "", metadata->camera_model);
+    }
+    if (metadata->orientation > 1 && metadata->orientation <= 8) {
+        static const char *const orientations[] = {"mirrored", "rotated 180", "flipped", "transposed",
+                                                   "rotated 90 CW", "transverse", "rotated 90 CCW"};
+        snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Orientation: %s",
+                 orientations[metadata->orientation - 2]);
+    }
+    if (metadata->capture_time > 0) {
+        char time_str[64];
+        struct tm *local = localtime(&metadata->capture_time);
+        if (local && strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", local) > 0) {
+            snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Taken: %s", time_str);
+        }
+    }
+
+    if (metadata->modification_time > 0) {
+        char time_str[64];
+        struct tm *local = localtime(&metadata->modification_time);
+        if (local && strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", local) > 0) {
+            snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Modified: %s", time_str);
+        }
+    }
+
+    snprintf(text->metadata_lines[line_count++], MAX_INFO_LINE_LENGTH, "Zoom: %.1fx", app->zoom);
+    text->metadata_line_count = line_count;
+
+    snprintf(text->summary_lines[0], sizeof(text->summary_lines[0]), "Image: %dx%d",
+             app->image_width, app->image_height);
+    snprintf(text->summary_lines[1], sizeof(text->summary_lines[1]), "Zoom: %.1fx", app->zoom);
+
+    text->metadata_version = app->metadata_version;
+    text->zoom = app->zoom;
+    text->valid = 1;
+}
+
+void render_metadata_overlay(App *app, const ImageMetadata *metadata) {
+    if (!app || !metadata || !app->show_info) {
+        return;
+    }
+
+    update_overlay_text(app, metadata);
+    const OverlayText *text = &app->overlay_text;
+
     // Create semi-transparent overlay background
     SDL_SetRenderDrawColor(app->renderer, 20, 20, 30, 230);
-    SDL_Rect info_rect = {15, 15, 380, 200};
+    int box_height = SDL_max(200, 63 + text->metadata_line_count * 22);
+    SDL_Rect info_rect = {15, 15, 380, box_height};
     SDL_RenderFillRect(app->renderer, &info_rect);
 
-    // Draw border with gradient effect
-    SDL_SetRenderDrawColor(app->renderer, 100, 150, 255, 255);
-    SDL_RenderDrawRect(app->renderer, &info_rect);
-    
-    // Add inner border for depth
-    SDL_SetRenderDrawColor(app->renderer, 150, 200, 255, 255);
-    SDL_Rect inner_rect = {17, 17, 376, 196};
-    SDL_RenderDrawRect(app->renderer, &inner_rect);
+    // Draw border with gradient effect
+    SDL_SetRenderDrawColor(app->renderer, 100, 150, 255, 255);
+    SDL_RenderDrawRect(app->renderer, &info_rect);
+    
+    // Add inner border for depth
+    SDL_SetRenderDrawColor(app->renderer, 150, 200, 255, 255);
+    SDL_Rect inner_rect = {17, 17, 376, box_height - 4};
+    SDL_RenderDrawRect(app->renderer, &inner_rect);
+
+    // Title section
+    SDL_SetRenderDrawColor(app->renderer, 255, 255, 255, 255);
+    SDL_Rect title_rect = {25, 25, 360, 30};
+    SDL_RenderFillRect(app->renderer, &title_rect);
+    
+    SDL_Color title_color = {30, 30, 50, 255};
+    queue_text(app->renderer, &app->font, 30, 32, "Image Information", 44, title_color);
+
+    int y_offset = 70;
+    SDL_Color line_color = {200, 200, 220, 255};
+
+    // Render info lines with background for readability
+    for (int i = 0; i < text->metadata_line_count; i++) {
+        // Background for each line
+        SDL_SetRenderDrawColor(app->renderer, 40, 40, 50, 200);
+        SDL_Rect line_bg = {25, y_offset + i * 22 - 2, 350, 18};
+        SDL_RenderFillRect(app->renderer, &line_bg);
+
+        queue_text(app->renderer, &app->font, 30, y_offset + i * 22 - 1, text->metadata_lines[i],
+                   (350 - 10) / GLYPH_WIDTH, line_color);
+    }
+    
+    // Add decorative elements
+    SDL_SetRenderDrawColor(app->renderer, 100, 150, 255, 255);
+    SDL_Rect decor1 = {25, 175, 360, 2};
+    SDL_RenderFillRect(app->renderer, &decor1);
+
+    flush_text(app->renderer, &app->font);
+}
+
+// Top-right panel with rolling p50/p99 per stage
+void render_stats_overlay(App *app) {
+    if (!app || !app->show_stats) {
+        return;
+    }
+
+    int width = 36 * GLYPH_WIDTH + 20;
+    int height = (STATS_STAGE_COUNT + 3) * 20 + 16;
+    SDL_Rect panel = {app->window_width - width - 15, 15, width, height};
+    SDL_SetRenderDrawColor(app->renderer, 20, 20, 30, 230);
+    SDL_RenderFillRect(app->renderer, &panel);
+    SDL_SetRenderDrawColor(app->renderer, 100, 150, 255, 255);
+    SDL_RenderDrawRect(app->renderer, &panel);
+
+    SDL_Color title_color = {150, 200, 255, 255};
+    SDL_Color line_color = {200, 200, 220, 255};
+    queue_text(app->renderer, &app->font, panel.x + 10, panel.y + 10, "stage        p50 ms   p99 ms", 36,
+               title_color);
+    for (int stage = 0; stage < STATS_STAGE_COUNT; stage++) {
+        char line[64];
+        StatsSummary summary;
+        if (stats_summarize(&app->stats, (StatsStage)stage, &summary)) {
+            snprintf(line, sizeof(line), "%-10s %8.2f %8.2f", stats_stage_names[stage], summary.p50_ms,
+                     summary.p99_ms);
+        } else {
+            snprintf(line, sizeof(line), "%-10s %8s %8s", stats_stage_names[stage], "-", "-");
+        }
+        queue_text(app->renderer, &app->font, panel.x + 10, panel.y + 30 + stage * 20, line, 36, line_color);
+    }
+
+    // Memory against the caps, in MiB; CPU includes idle pool buffers kept for reuse
+    char line[64];
+    const double mib = 1024.0 * 1024.0;
+    int top = panel.y + 30 + STATS_STAGE_COUNT * 20;
+    snprintf(line, sizeof(line), "gpu %7.0f / %.0f MiB", app->cache.bytes / mib, app->memory.gpu_cap / mib);
+    queue_text(app->renderer, &app->font, panel.x + 10, top, line, 36, line_color);
+    snprintf(line, sizeof(line), "cpu %7.0f / %.0f MiB  ev %d",
+             (memory_budget_cpu_bytes(&app->memory) + pixel_pool_idle(&app->pixel_pool)) / mib,
+             app->memory.cpu_cap / mib, app->memory.evictions);
+    queue_text(app->renderer, &app->font, panel.x + 10, top + 20, line, 36, line_color);
+    flush_text(app->renderer, &app->font);
+}
+
+// Grid view functions
+// Replaces the thumbnail queue with the given directory entries, decoded front to back
+void image_loader_thumbnails(ImageLoader *loader, const DirectoryIndex *index, const int *indices, int count) {
+    if (!loader || !loader->thread || !index || count < 0) {
+        return;
+    }
+
+    SDL_LockMutex(loader->lock);
+    loader->thumbnail_next = 0;
+    loader->thumbnail_count = 0;
+    for (int i = 0; i < count && loader->thumbnail_count < GRID_MAX_SLOTS; i++) {
+        if (directory_index_path(index, indices[i], loader->thumbnail_paths[loader->thumbnail_count],
+                                 MAX_PATH_LENGTH)) {
+            loader->thumbnail_indices[loader->thumbnail_count++] = indices[i];
+        }
+    }
+    if (loader->thumbnail_count > 0) {
+        SDL_CondSignal(loader->wake);
+    }
+    SDL_UnlockMutex(loader->lock);
+}
+
+void grid_view_destroy(GridView *grid) {
+    for (int i = 0; i < grid->atlas_count; i++) {
+        SDL_DestroyTexture(grid->atlases[i]);
+    }
+    safe_free((void **)&grid->file_slots);
+    safe_free((void **)&grid->file_failed);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    safe_free((void **)&grid->vertices);
+    safe_free((void **)&grid->indices);
+#endif
+    secure_memzero(grid, sizeof(GridView));
+}
+
+static void grid_view_reset_slots(GridView *grid) {
+    for (int i = 0; i < GRID_MAX_SLOTS; i++) {
+        grid->slot_files[i] = -1;
+        grid->slot_frames[i] = 0;
+    }
+    for (int i = 0; i < grid->file_count; i++) {
+        grid->file_slots[i] = -1;
+        grid->file_failed[i] = 0;
+    }
+    grid->requested_first = -1;
+    grid->requested_last = -1;
+}
+
+// Creates the atlases on first use and keeps per-file state sized to the directory
+static int grid_view_prepare(App *app) {
+    GridView *grid = &app->grid;
+
+    if (grid->atlas_count == 0) {
+        int size = GRID_ATLAS_SIZE;
+        if (app->max_texture_width > 0) {
+            size = SDL_min(size, app->max_texture_width);
+        }
+        if (app->max_texture_height > 0) {
+            size = SDL_min(size, app->max_texture_height);
+        }
+        grid->slots_per_row = size / THUMBNAIL_SIZE;
+        if (grid->slots_per_row < 1) {
+            return 0;
+        }
+        grid->slots_per_atlas = grid->slots_per_row * grid->slots_per_row;
+
+        for (int i = 0; i < GRID_ATLAS_COUNT; i++) {
+            SDL_Texture *atlas = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888,
+                                                   SDL_TEXTUREACCESS_STREAMING, size, size);
+            if (!atlas) {
+                break;
+            }
+            SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+            grid->atlases[grid->atlas_count++] = atlas;
+        }
+        grid->slot_count = grid->atlas_count * grid->slots_per_atlas;
+
+        if (grid->atlas_count == 0) {
+            SDL_Log("Failed to create thumbnail atlases: %s", SDL_GetError());
+            grid_view_destroy(grid);
+            return 0;
+        }
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        if (safe_calloc((void **)&grid->vertices, GRID_MAX_SLOTS * 4, sizeof(SDL_Vertex)) != SECURITY_OK ||
+            safe_calloc((void **)&grid->indices, GRID_MAX_SLOTS * 6, sizeof(int)) != SECURITY_OK) {
+            SDL_Log("Failed to allocate thumbnail geometry");
+            grid_view_destroy(grid);
+            return 0;
+        }
+        for (int i = 0; i < GRID_MAX_SLOTS; i++) {
+            int *quad = &grid->indices[i * 6];
+            quad[0] = i * 4;
+            quad[1] = i * 4 + 1;
+            quad[2] = i * 4 + 2;
+            quad[3] = i * 4 + 2;
+            quad[4] = i * 4 + 3;
+            quad[5] = i * 4;
+        }
+#endif
+        grid_view_reset_slots(grid);
+    }
+
+    if (grid->file_count != app->directory.count || strcmp(grid->directory, app->directory.directory) != 0) {
+        safe_free((void **)&grid->file_slots);
+        safe_free((void **)&grid->file_failed);
+        grid->file_count = 0;
+        if (app->directory.count > 0 &&
+            (safe_calloc((void **)&grid->file_slots, (size_t)app->directory.count, sizeof(int)) != SECURITY_OK ||
+             safe_calloc((void **)&grid->file_failed, (size_t)app->directory.count, 1) != SECURITY_OK)) {
+            safe_free((void **)&grid->file_slots);
+            return 0;
+        }
+        grid->file_count = app->directory.count;
+        memcpy(grid->directory, app->directory.directory, sizeof(grid->directory));
+        grid_view_reset_slots(grid);
+    }
+
+    return 1;
+}
+
+static int grid_columns(const App *app) {
+    return SDL_max(1, app->window_width / GRID_CELL_WIDTH);
+}
+
+static int grid_offset_x(const App *app) {
+    return (app->window_width - grid_columns(app) * GRID_CELL_WIDTH) / 2;
+}
+
+static void grid_clamp_scroll(App *app) {
+    int rows = (app->directory.count + grid_columns(app) - 1) / grid_columns(app);
+    int max_scroll = SDL_max(0, rows * GRID_CELL_HEIGHT - app->window_height);
+    app->grid.scroll_y = SDL_max(0, SDL_min(app->grid.scroll_y, max_scroll));
+}
+
+static void grid_scroll_to_selected(App *app) {
+    int top = (app->grid.selected / grid_columns(app)) * GRID_CELL_HEIGHT;
+    if (top < app->grid.scroll_y) {
+        app->grid.scroll_y = top;
+    } else if (top + GRID_CELL_HEIGHT > app->grid.scroll_y + app->window_height) {
+        app->grid.scroll_y = top + GRID_CELL_HEIGHT - app->window_height;
+    }
+    grid_clamp_scroll(app);
+}
+
+void grid_view_enter(App *app) {
+    if (app->directory.count == 0) {
+        return;
+    }
+
+    app->grid.active = 1;
+    app->grid.selected = app->directory.current >= 0 ? app->directory.current : 0;
+    app->grid.requested_first = -1;
+    grid_scroll_to_selected(app);
+    app->needs_redraw = 1;
+}
+
+void grid_view_leave(App *app) {
+    app->grid.active = 0;
+    image_loader_thumbnails(&app->loader, &app->directory, NULL, 0);
+    app->needs_redraw = 1;
+}
+
+void grid_view_open_selected(App *app) {
+    char path[MAX_PATH_LENGTH];
+    if (!directory_index_path(&app->directory, app->grid.selected, path, sizeof(path))) {
+        return;
+    }
+
+    app->directory.current = app->grid.selected;
+    grid_view_leave(app);
+    view_reset(app, app->fit_to_window);
+    show_image(app, path);
+}
+
+// Asks the loader for visible entries that have neither a slot nor a failed decode
+static void grid_view_request(App *app, int first, int last) {
+    GridView *grid = &app->grid;
+    if (first == grid->requested_first && last == grid->requested_last) {
+        return;
+    }
+    grid->requested_first = first;
+    grid->requested_last = last;
+
+    int indices[GRID_MAX_SLOTS];
+    int count = 0;
+    for (int i = first; i < last && count < grid->slot_count; i++) {
+        if (grid->file_slots[i] < 0 && !grid->file_failed[i]) {
+            indices[count++] = i;
+        }
+    }
+    image_loader_thumbnails(&app->loader, &app->directory, indices, count);
+}
+
+// Copies an arriving thumbnail into a free slot, or the one drawn least recently
+void grid_view_receive(App *app, ThumbnailResult *result) {
+    GridView *grid = &app->grid;
+    int index = result->index;
+    char path[MAX_PATH_LENGTH];
+
+    if (grid->slot_count == 0 || index < 0 || index >= grid->file_count || grid->file_slots[index] >= 0 ||
+        !directory_index_path(&app->directory, index, path, sizeof(path)) || strcmp(path, result->filepath) != 0) {
+        thumbnail_result_free(result);
+        return;
+    }
+
+    SDL_Surface *thumbnail = result->thumbnail;
+    if (!thumbnail) {
+        grid->file_failed[index] = 1;
+        thumbnail_result_free(result);
+        return;
+    }
+
+    int slot = -1;
+    for (int i = 0; i < grid->slot_count; i++) {
+        if (grid->slot_files[i] < 0) {
+            slot = i;
+            break;
+        }
+        if (grid->slot_frames[i] != grid->frame && (slot < 0 || grid->slot_frames[i] < grid->slot_frames[slot])) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        thumbnail_result_free(result);
+        return;
+    }
+
+    int cell = slot % grid->slots_per_atlas;
+    SDL_Rect rect = {(cell % grid->slots_per_row) * THUMBNAIL_SIZE, (cell / grid->slots_per_row) * THUMBNAIL_SIZE,
+                     SDL_min(thumbnail->w, THUMBNAIL_SIZE), SDL_min(thumbnail->h, THUMBNAIL_SIZE)};
+    if (texture_upload_pixels(grid->atlases[slot / grid->slots_per_atlas], SDL_PIXELFORMAT_ARGB8888, &rect,
+                              thumbnail->pixels, thumbnail->pitch, thumbnail->format->format)) {
+        if (grid->slot_files[slot] >= 0) {
+            grid->file_slots[grid->slot_files[slot]] = -1;
+        }
+        grid->slot_files[slot] = index;
+        grid->slot_rects[slot] = rect;
+        grid->slot_orientations[slot] = result->orientation;
+        grid->slot_frames[slot] = grid->frame;
+        grid->file_slots[index] = slot;
+        app->needs_redraw = app->needs_redraw || grid->active;
+    }
+    thumbnail_result_free(result);
+}
+
+// Per-file grid state follows directory index edits, so only the affected thumbnail is redone.
+// These run after the index has changed; a grid not yet sized to the old count is rebuilt anyway.
+static int grid_view_tracks(const GridView *grid, const DirectoryIndex *index, int old_count) {
+    return grid->file_slots && grid->file_count == old_count && strcmp(grid->directory, index->directory) == 0;
+}
+
+// Frees the atlas slot of a file so its thumbnail is requested again
+static void grid_view_drop_slot(GridView *grid, int position) {
+    int slot = grid->file_slots[position];
+    if (slot >= 0) {
+        grid->slot_files[slot] = -1;
+        grid->slot_frames[slot] = 0;
+    }
+    grid->file_slots[position] = -1;
+    grid->file_failed[position] = 0;
+    grid->requested_first = -1;
+}
+
+void grid_view_insert(App *app, int position) {
+    GridView *grid = &app->grid;
+    if (!grid_view_tracks(grid, &app->directory, app->directory.count - 1)) {
+        return;
+    }
+
+    int *file_slots = (int *)realloc(grid->file_slots, (size_t)app->directory.count * sizeof(int));
+    if (file_slots) {
+        grid->file_slots = file_slots;
+    }
+    Uint8 *file_failed = (Uint8 *)realloc(grid->file_failed, (size_t)app->directory.count);
+    if (file_failed) {
+        grid->file_failed = file_failed;
+    }
+    if (!file_slots || !file_failed) {
+        // Left mismatched, so grid_view_prepare rebuilds it
+        grid->file_count = -1;
+        return;
+    }
+
+    int moved = grid->file_count - position;
+    memmove(&grid->file_slots[position + 1], &grid->file_slots[position], (size_t)moved * sizeof(int));
+    memmove(&grid->file_failed[position + 1], &grid->file_failed[position], (size_t)moved);
+    for (int i = 0; i < grid->slot_count; i++) {
+        if (grid->slot_files[i] >= position) {
+            grid->slot_files[i]++;
+        }
+    }
+    grid->file_count++;
+    grid->file_slots[position] = -1;
+    grid->file_failed[position] = 0;
+    grid->requested_first = -1;
+    if (grid->selected >= position && grid->selected + 1 < grid->file_count) {
+        grid->selected++;
+    }
+    app->needs_redraw = app->needs_redraw || grid->active;
+}
+
+void grid_view_remove(App *app, int position) {
+    GridView *grid = &app->grid;
+    if (!grid_view_tracks(grid, &app->directory, app->directory.count + 1)) {
+        return;
+    }
+
+    grid_view_drop_slot(grid, position);
+    int moved = grid->file_count - position - 1;
+    memmove(&grid->file_slots[position], &grid->file_slots[position + 1], (size_t)moved * sizeof(int));
+    memmove(&grid->file_failed[position], &grid->file_failed[position + 1], (size_t)moved);
+    for (int i = 0; i < grid->slot_count; i++) {
+        if (grid->slot_files[i] > position) {
+            grid->slot_files[i]--;
+        }
+    }
+    grid->file_count--;
+    if (grid->selected > position || grid->selected >= grid->file_count) {
+        grid->selected = SDL_max(0, grid->selected - 1);
+    }
+    app->needs_redraw = app->needs_redraw || grid->active;
+}
+
+void grid_view_invalidate(App *app, int position) {
+    GridView *grid = &app->grid;
+    if (!grid_view_tracks(grid, &app->directory, app->directory.count) || position >= grid->file_count) {
+        return;
+    }
+
+    grid_view_drop_slot(grid, position);
+    app->needs_redraw = app->needs_redraw || grid->active;
+}
+
+// One fill for the cell backgrounds, one geometry batch per atlas and one for the labels
+void render_grid(App *app) {
+    GridView *grid = &app->grid;
+    if (!grid_view_prepare(app)) {
+        return;
+    }
+
+    grid_clamp_scroll(app);
+    grid->frame++;
+
+    int columns = grid_columns(app);
+    int offset_x = grid_offset_x(app);
+    int first = (grid->scroll_y / GRID_CELL_HEIGHT) * columns;
+    int last = ((grid->scroll_y + app->window_height - 1) / GRID_CELL_HEIGHT + 1) * columns;
+    last = SDL_min(SDL_min(last, app->directory.count), first + GRID_MAX_SLOTS);
+    if (first >= last) {
+        return;
+    }
+
+    grid_view_request(app, first, last);
+
+    SDL_Rect cells[GRID_MAX_SLOTS];
+    for (int i = first; i < last; i++) {
+        SDL_Rect *cell = &cells[i - first];
+        cell->x = offset_x + (i % columns) * GRID_CELL_WIDTH + (GRID_CELL_WIDTH - GRID_THUMBNAIL_BOX) / 2;
+        cell->y = (i / columns) * GRID_CELL_HEIGHT - grid->scroll_y + 8;
+        cell->w = GRID_THUMBNAIL_BOX;
+        cell->h = GRID_THUMBNAIL_BOX;
+    }
+    SDL_SetRenderDrawColor(app->renderer, 35, 35, 48, 255);
+    SDL_RenderFillRects(app->renderer, cells, last - first);
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_Color white = {255, 255, 255, 255};
+#endif
+    for (int atlas = 0; atlas < grid->atlas_count; atlas++) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        int quad_count = 0;
+        float size = (float)(grid->slots_per_row * THUMBNAIL_SIZE);
+#endif
+
+        for (int i = first; i < last; i++) {
+            int slot = grid->file_slots[i];
+            if (slot < 0 || slot / grid->slots_per_atlas != atlas) {
+                continue;
+            }
+            grid->slot_frames[slot] = grid->frame;
+
+            // Fit the thumbnail into its cell as displayed, keeping the aspect ratio
+            const SDL_Rect *src = &grid->slot_rects[slot];
+            const SDL_Rect *cell = &cells[i - first];
+            int orientation = grid->slot_orientations[slot];
+            int swap = orientation_swaps_axes(orientation);
+            float display_w = (float)(swap ? src->h : src->w);
+            float display_h = (float)(swap ? src->w : src->h);
+            float scale = SDL_min(cell->w / display_w, cell->h / display_h);
+            float w = display_w * scale;
+            float h = display_h * scale;
+            float x0 = cell->x + (cell->w - w) / 2;
+            float y0 = cell->y + (cell->h - h) / 2;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+            // Orientation only reorders the texture coordinates of the four corners
+            static const int corners[4][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 1}};
+            SDL_Vertex *quad = &grid->vertices[quad_count * 4];
+            for (int c = 0; c < 4; c++) {
+                int source_x, source_y;
+                orientation_source_corner(orientation, corners[c][0], corners[c][1], &source_x, &source_y);
+                quad[c] = (SDL_Vertex){{x0 + corners[c][0] * w, y0 + corners[c][1] * h}, white,
+                                       {(src->x + source_x * src->w) / size, (src->y + source_y * src->h) / size}};
+            }
+            quad_count++;
+#else
+            // Older SDL has no geometry API; each thumbnail is its own copy
+            SDL_Rect dest = {(int)x0, (int)y0, (int)w, (int)h};
+            SDL_Rect stored = orientation_stored_rect(&dest, orientation);
+            render_copy_clipped(app->renderer, grid->atlases[atlas], src, &stored, NULL, &stored, orientation);
+#endif
+        }
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        if (quad_count > 0) {
+            SDL_RenderGeometry(app->renderer, grid->atlases[atlas], grid->vertices, quad_count * 4,
+                               grid->indices, quad_count * 6);
+        }
+#endif
+    }
+
+    SDL_Color label = {200, 200, 220, 255};
+    int label_chars = GRID_THUMBNAIL_BOX / GLYPH_WIDTH;
+    for (int i = first; i < last; i++) {
+        const SDL_Rect *cell = &cells[i - first];
+        queue_text(app->renderer, &app->font, cell->x, cell->y + cell->h + 8, app->directory.files[i],
+                   label_chars, label);
+    }
+    flush_text(app->renderer, &app->font);
+
+    if (grid->selected >= first && grid->selected < last) {
+        const SDL_Rect *cell = &cells[grid->selected - first];
+        SDL_Rect frame = {cell->x - 3, cell->y - 3, cell->w + 6, cell->h + 6};
+        SDL_SetRenderDrawColor(app->renderer, 80, 120, 200, 255);
+        SDL_RenderDrawRect(app->renderer, &frame);
+    }
+}
+
+void handle_grid_key(App *app, SDL_Keycode key) {
+    GridView *grid = &app->grid;
+    int columns = grid_columns(app);
+    int page = SDL_max(1, app->window_height / GRID_CELL_HEIGHT) * columns;
+    int selected = grid->selected;
+
+    switch (key) {
+        case SDLK_ESCAPE:
+        case SDLK_g:
+            grid_view_leave(app);
+            return;
+        case SDLK_RETURN:
+        case SDLK_KP_ENTER:
+            grid_view_open_selected(app);
+            return;
+        case SDLK_LEFT:
+            selected--;
+            break;
+        case SDLK_RIGHT:
+            selected++;
+            break;
+        case SDLK_UP:
+            selected -= columns;
+            break;
+        case SDLK_DOWN:
+            selected += columns;
+            break;
+        case SDLK_PAGEUP:
+            selected -= page;
+            break;
+        case SDLK_PAGEDOWN:
+            selected += page;
+            break;
+        case SDLK_HOME:
+            selected = 0;
+            break;
+        case SDLK_END:
+            selected = app->directory.count - 1;
+            break;
+        default:
+            return;
+    }
+
+    grid->selected = SDL_max(0, SDL_min(selected, app->directory.count - 1));
+    grid_scroll_to_selected(app);
+    app->needs_redraw = 1;
+}
+
+// A click selects a cell; clicking the selected cell again opens it
+void handle_grid_click(App *app, int x, int y) {
+    int column = (x - grid_offset_x(app)) / GRID_CELL_WIDTH;
+    int row = (y + app->grid.scroll_y) / GRID_CELL_HEIGHT;
+    if (x < grid_offset_x(app) || column >= grid_columns(app)) {
+        return;
+    }
+
+    int index = row * grid_columns(app) + column;
+    if (index < 0 || index >= app->directory.count) {
+        return;
+    }
+
+    if (index == app->grid.selected) {
+        grid_view_open_selected(app);
+    } else {
+        app->grid.selected = index;
+        app->needs_redraw = 1;
+    }
+}
+
+// Directory watch functions
+void directory_watch_stop(DirectoryWatcher *watcher) {
+    if (!watcher) {
+        return;
+    }
+
+#ifdef _WIN32
+    if (watcher->active) {
+        DWORD bytes = 0;
+        CancelIo(watcher->handle);
+        GetOverlappedResult(watcher->handle, &watcher->overlapped, &bytes, TRUE);
+    }
+    if (watcher->handle && watcher->handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(watcher->handle);
+    }
+    if (watcher->overlapped.hEvent) {
+        CloseHandle(watcher->overlapped.hEvent);
+    }
+    safe_free((void **)&watcher->buffer);
+#else
+    if (watcher->active) {
+        close(watcher->fd);
+    }
+#endif
+    safe_free((void **)&watcher->pending);
+    secure_memzero(watcher, sizeof(DirectoryWatcher));
+}
+
+#ifdef _WIN32
+static int directory_watch_arm(DirectoryWatcher *watcher) {
+    ResetEvent(watcher->overlapped.hEvent);
+    return ReadDirectoryChangesW(watcher->handle, watcher->buffer, WATCH_BUFFER_BYTES, FALSE,
+                                 FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE |
+                                 FILE_NOTIFY_CHANGE_SIZE, NULL, &watcher->overlapped, NULL) != 0;
+}
+#endif
+
+int directory_watch_start(DirectoryWatcher *watcher, const char *directory) {
+    directory_watch_stop(watcher);
+    watcher->started = 1;
+    secure_strncpy(watcher->directory, directory, sizeof(watcher->directory));
+    const char *path = directory[0] != '\0' ? directory : ".";
+
+    if (safe_malloc_uninitialized((void **)&watcher->pending, (size_t)WATCH_MAX_PENDING * MAX_FILENAME_LENGTH) !=
+        SECURITY_OK) {
+        return 0;
+    }
+
+#ifdef _WIN32
+    watcher->handle = CreateFileA(path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                  NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    watcher->overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (watcher->handle == INVALID_HANDLE_VALUE || !watcher->overlapped.hEvent ||
+        safe_malloc_uninitialized((void **)&watcher->buffer, WATCH_BUFFER_BYTES) != SECURITY_OK ||
+        !directory_watch_arm(watcher)) {
+        SDL_Log("Cannot watch %s for changes (error %lu)", path, (unsigned long)GetLastError());
+        return 0;
+    }
+#elif defined(__linux__)
+    watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watcher->fd < 0) {
+        SDL_Log("Cannot watch %s for changes: %s", path, strerror(errno));
+        return 0;
+    }
+    // Files count as changed once closed after writing or moved in whole, not while being written;
+    // creates are kept for links, which never see a write
+    Uint32 mask = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    if (inotify_add_watch(watcher->fd, path, mask) < 0) {
+        SDL_Log("Cannot watch %s for changes: %s", path, strerror(errno));
+        close(watcher->fd);
+        return 0;
+    }
+#else
+    SDL_Log("Cannot watch %s for changes: not supported on this platform", path);
+    return 0;
+#endif
+
+    watcher->active = 1;
+    return 1;
+}
 
-    // Title section
-    SDL_SetRenderDrawColor(app->renderer, 255, 255, 255, 255);
-    SDL_Rect title_rect = {25, 25, 360, 30};
-    SDL_RenderFillRect(app->renderer, &title_rect);
-    
-    // Render title text (simulated with rectangles for now)
-    SDL_SetRenderDrawColor(app->renderer, 30, 30, 50, 255);
-    SDL_Rect title_text_rect = {30, 30, 200, 20};
-    SDL_RenderFillRect(app->renderer, &title_text_rect);
+static void directory_watch_note(DirectoryWatcher *watcher, const char *name) {
+    watcher->last_event = animation_ticks();
+    if (watcher->overflowed) {
+        return;
+    }
+    for (int i = 0; i < watcher->pending_count; i++) {
+        if (strcmp(watcher->pending[i], name) == 0) {
+            return;
+        }
+    }
+    if (watcher->pending_count == WATCH_MAX_PENDING || strlen(name) >= MAX_FILENAME_LENGTH) {
+        watcher->overflowed = 1;
+        return;
+    }
+    secure_strncpy(watcher->pending[watcher->pending_count++], name, MAX_FILENAME_LENGTH);
+}
 
-    char info_lines[8][300];
-    int line_count = 0;
-    int y_offset = 70;
+// Collects whatever notifications have arrived without blocking
+#ifdef __linux__
+// Links and hard links arrive complete; an empty new file is still being written and is
+// noted when it is closed instead
+static int directory_watch_created_complete(const DirectoryWatcher *watcher, const char *name) {
+    char path[MAX_PATH_LENGTH];
+    struct stat file_stat;
+    return join_path(path, sizeof(path), watcher->directory, name) && lstat(path, &file_stat) == 0 &&
+           (S_ISLNK(file_stat.st_mode) || file_stat.st_size > 0);
+}
+#endif
 
-    snprintf(info_lines[line_count++], 290, "File: %s", metadata->filename);
-    snprintf(info_lines[line_count++], 290, "Format: %s", metadata->format);
-    snprintf(info_lines[line_count++], 290, "Dimensions: %dx%d", metadata->width, metadata->height);
-    snprintf(info_lines[line_count++], 290, "Size: %s", format_file_size(metadata->file_size));
-    snprintf(info_lines[line_count++], 290, "Color Depth: %d bpp", metadata->bits_per_pixel);
-    
-    if (metadata->modification_time > 0) {
-        char time_str[64];
-        strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M", localtime(&metadata->modification_time));
-        snprintf(info_lines[line_count++], 290, "Modified: %s", time_str);
+static void directory_watch_read(DirectoryWatcher *watcher) {
+#ifdef _WIN32
+    DWORD bytes = 0;
+    while (GetOverlappedResult(watcher->handle, &watcher->overlapped, &bytes, FALSE)) {
+        // Zero bytes means the buffer overflowed and the changes were dropped
+        if (bytes == 0) {
+            watcher->overflowed = 1;
+            watcher->last_event = animation_ticks();
+        }
+        const Uint8 *record = (const Uint8 *)watcher->buffer;
+        while (bytes > 0) {
+            const FILE_NOTIFY_INFORMATION *info = (const FILE_NOTIFY_INFORMATION *)record;
+            char name[MAX_FILENAME_LENGTH];
+            int length = WideCharToMultiByte(CP_ACP, 0, info->FileName, (int)(info->FileNameLength / sizeof(WCHAR)),
+                                             name, sizeof(name) - 1, NULL, NULL);
+            if (length > 0) {
+                name[length] = '\0';
+                directory_watch_note(watcher, name);
+            }
+            if (info->NextEntryOffset == 0) {
+                break;
+            }
+            record += info->NextEntryOffset;
+        }
+        if (!directory_watch_arm(watcher)) {
+            SDL_Log("Stopped watching %s (error %lu)", watcher->directory, (unsigned long)GetLastError());
+            CloseHandle(watcher->handle);
+            watcher->handle = INVALID_HANDLE_VALUE;
+            watcher->active = 0;
+            return;
+        }
+    }
+#elif defined(__linux__)
+    Uint8 buffer[4096];
+    ssize_t length;
+    while ((length = read(watcher->fd, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t pos = 0; pos + (ssize_t)sizeof(struct inotify_event) <= length;) {
+            struct inotify_event event;
+            memcpy(&event, buffer + pos, sizeof(event));
+            if (event.mask & IN_Q_OVERFLOW) {
+                watcher->overflowed = 1;
+                watcher->last_event = animation_ticks();
+            } else if (event.len > 0) {
+                const char *name = (const char *)buffer + pos + sizeof(event);
+                if (!(event.mask & IN_CREATE) || directory_watch_created_complete(watcher, name)) {
+                    directory_watch_note(watcher, name);
+                }
+            }
+            pos += (ssize_t)(sizeof(event) + event.len);
+        }
     }
+#else
+    (void)watcher;
+#endif
+}
 
-    snprintf(info_lines[line_count++], 290, "Zoom: %.1fx", app->zoom);
+// Drops cached textures of path that no longer match the file on disk, or all of them when the
+// file is known to have been rewritten. The image on screen is marked stale and reloaded in
+// place instead, and stays up until the new version or another image replaces it.
+static void texture_cache_invalidate(App *app, const char *path, const struct stat *file_stat, int rewritten) {
+    int reload = 0;
+    for (int i = 0; i < TEXTURE_CACHE_SIZE; i++) {
+        TextureCacheEntry *entry = &app->cache.entries[i];
+        if (entry->image.level_count == 0 || strcmp(entry->filepath, path) != 0) {
+            continue;
+        }
+        if (file_stat && !rewritten && entry->metadata.modification_time == file_stat->st_mtime &&
+            entry->metadata.file_size == (long)file_stat->st_size) {
+            continue;
+        }
+        if (&entry->image == app->image) {
+            // Never served from the cache again, even if the reload below is not started
+            entry->stale = 1;
+            reload = file_stat != NULL;
+            continue;
+        }
+        texture_cache_release(&app->cache, entry);
+    }
 
-    // Render info lines with background for readability
-    for (int i = 0; i < line_count; i++) {
-        // Background for each line
-        SDL_SetRenderDrawColor(app->renderer, 40, 40, 50, 200);
-        SDL_Rect line_bg = {25, y_offset + i * 22 - 2, 350, 18};
-        SDL_RenderFillRect(app->renderer, &line_bg);
-        
-        // Text placeholder (simulated with small rectangles)
-        SDL_SetRenderDrawColor(app->renderer, 200, 200, 220, 255);
-        SDL_Rect text_placeholder = {30, y_offset + i * 22, 8, 12};
-        SDL_RenderFillRect(app->renderer, &text_placeholder);
-        
-        SDL_Log("Info: %s", info_lines[i]);
+    if (reload && !app->loading && strcmp(app->current_path, path) == 0) {
+        char current[MAX_PATH_LENGTH];
+        memcpy(current, app->current_path, sizeof(current));
+        SDL_Log("Reloading changed image: %s", current);
+        load_image(app, current);
     }
-    
-    // Add decorative elements
-    SDL_SetRenderDrawColor(app->renderer, 100, 150, 255, 255);
-    SDL_Rect decor1 = {25, 175, 360, 2};
-    SDL_RenderFillRect(app->renderer, &decor1);
-    
-    secure_memzero(info_lines, sizeof(info_lines));
+}
+
+// Brings the index, grid and texture cache up to date for one name in the watched folder;
+// returns 1 when an entry was added or removed
+static int directory_refresh_file(App *app, const char *name) {
+    DirectoryIndex *index = &app->directory;
+    char path[MAX_PATH_LENGTH];
+    if (name[0] == '.' || strchr(name, '/') || strchr(name, '\\') ||
+        strcmp(get_format_name(name), "Unknown") == 0 || !join_path(path, sizeof(path), index->directory, name)) {
+        return 0;
+    }
+
+    struct stat file_stat;
+    int exists = stat(path, &file_stat) == 0 && S_ISREG(file_stat.st_mode);
+    int found = 0;
+    int position = directory_index_find(index, name, &found);
+    int listed = 0;
+    if (exists && !found) {
+        listed = directory_index_insert(index, position, name);
+        if (listed) {
+            grid_view_insert(app, position);
+        }
+    } else if (!exists && found) {
+        directory_index_remove(index, position);
+        grid_view_remove(app, position);
+        listed = 1;
+    } else if (exists) {
+        grid_view_invalidate(app, position);
+    }
+
+    texture_cache_invalidate(app, path, exists ? &file_stat : NULL, 1);
+    return listed;
+}
+
+// After lost notifications: diffs a fresh listing against the index. Walking both from the
+// end keeps the positions still to be visited valid while entries are inserted and removed.
+static int directory_watch_resync(App *app) {
+    DirectoryIndex *index = &app->directory;
+    DirectoryIndex listing;
+    secure_memzero(&listing, sizeof(listing));
+    memcpy(listing.directory, index->directory, sizeof(listing.directory));
+    if (!directory_index_list(&listing)) {
+        directory_index_free(&listing);
+        return 0;
+    }
+
+    int changed = 0;
+    int i = listing.count - 1;
+    int j = index->count - 1;
+    while (i >= 0 || j >= 0) {
+        int order = i < 0 ? -1 : j < 0 ? 1 : strcmp(listing.files[i], index->files[j]);
+        char name[MAX_FILENAME_LENGTH];
+        if (order == 0) {
+            i--;
+            j--;
+            continue;
+        }
+        secure_strncpy(name, order > 0 ? listing.files[i--] : index->files[j--], sizeof(name));
+        changed |= directory_refresh_file(app, name);
+    }
+    directory_index_free(&listing);
+
+    // In-place rewrites show up only in mtimes: check what is cached, and let the grid ask the
+    // thumbnail cache again, which compares mtimes itself
+    for (int k = 0; k < TEXTURE_CACHE_SIZE; k++) {
+        TextureCacheEntry *entry = &app->cache.entries[k];
+        struct stat file_stat;
+        if (entry->image.level_count > 0) {
+            char path[MAX_PATH_LENGTH];
+            memcpy(path, entry->filepath, sizeof(path));
+            int exists = stat(path, &file_stat) == 0 && S_ISREG(file_stat.st_mode);
+            texture_cache_invalidate(app, path, exists ? &file_stat : NULL, 0);
+        }
+    }
+    if (grid_view_tracks(&app->grid, index, index->count)) {
+        grid_view_reset_slots(&app->grid);
+        app->needs_redraw = app->needs_redraw || app->grid.active;
+    }
+    return changed;
+}
+
+// Follows the indexed folder and applies settled changes; runs once per main loop iteration
+void directory_watch_update(App *app) {
+    DirectoryWatcher *watcher = &app->watcher;
+    if (app->directory.count > 0 &&
+        (!watcher->started || strcmp(watcher->directory, app->directory.directory) != 0)) {
+        directory_watch_start(watcher, app->directory.directory);
+    }
+    if (!watcher->active) {
+        return;
+    }
+
+    directory_watch_read(watcher);
+    if ((watcher->pending_count == 0 && !watcher->overflowed) ||
+        animation_ticks() - watcher->last_event < WATCH_SETTLE_MS) {
+        return;
+    }
+
+    int changed = 0;
+    if (watcher->overflowed) {
+        SDL_Log("Change notifications overflowed; resyncing %s", watcher->directory);
+        changed = directory_watch_resync(app);
+    } else {
+        for (int i = 0; i < watcher->pending_count; i++) {
+            changed |= directory_refresh_file(app, watcher->pending[i]);
+        }
+    }
+    watcher->pending_count = 0;
+    watcher->overflowed = 0;
+
+    if (changed) {
+        SDL_Log("Folder changed: %d images", app->directory.count);
+        // A new neighbour of the image on screen is worth decoding ahead
+        if (!app->loading && !app->grid.active) {
+            schedule_prefetch(app);
+        }
+        app->needs_redraw = 1;
+    }
+}
+
+// Wake-up deadline for changes that are waiting to settle
+int directory_watch_wait_ms(const App *app) {
+    const DirectoryWatcher *watcher = &app->watcher;
+    if (!watcher->active || (watcher->pending_count == 0 && !watcher->overflowed)) {
+        return EVENT_WAIT_TIMEOUT_MS;
+    }
+    Uint64 elapsed = animation_ticks() - watcher->last_event;
+    return elapsed >= WATCH_SETTLE_MS ? 0 : (int)SDL_min(WATCH_SETTLE_MS - elapsed, (Uint64)EVENT_WAIT_TIMEOUT_MS);
 }
 
 // UI functions
-void render_image(App *app) {
-    if (!app) return;
-    
+void render_loading_placeholder(App *app) {
+    // Centered frame with three dots while the loader thread decodes
+    SDL_Rect frame = {app->window_width / 2 - 60, app->window_height / 2 - 20, 120, 40};
+    SDL_SetRenderDrawColor(app->renderer, 10, 10, 20, 180);
+    SDL_RenderFillRect(app->renderer, &frame);
+    SDL_SetRenderDrawColor(app->renderer, 80, 120, 200, 255);
+    SDL_RenderDrawRect(app->renderer, &frame);
+
+    SDL_SetRenderDrawColor(app->renderer, 200, 200, 220, 255);
+    for (int i = 0; i < 3; i++) {
+        SDL_Rect dot = {frame.x + 36 + i * 20, frame.y + 16, 8, 8};
+        SDL_RenderFillRect(app->renderer, &dot);
+    }
+}
+
+void render_background(App *app) {
     // Create gradient background
     SDL_SetRenderDrawColor(app->renderer, 25, 25, 35, 255);
     SDL_RenderClear(app->renderer);
+}
+
+// Places an image of the given size in the window; returns 0 when it is too large to draw
+int compute_dest_rect(const App *app, int image_width, int image_height, SDL_Rect *out) {
+    SDL_Rect dest_rect;
+
+    if (image_width <= 0 || image_height <= 0) {
+        return 0;
+    }
+
+    if (app->fit_to_window) {
+        float aspect_ratio = (float)image_width / image_height;
+        float window_aspect_ratio = (float)app->window_width / app->window_height;
+
+        if (aspect_ratio > window_aspect_ratio) {
+            dest_rect.w = app->window_width;
+            dest_rect.h = (int)(app->window_width / aspect_ratio);
+            dest_rect.x = 0;
+            dest_rect.y = (app->window_height - dest_rect.h) / 2;
+        } else {
+            dest_rect.h = app->window_height;
+            dest_rect.w = (int)(app->window_height * aspect_ratio);
+            dest_rect.x = (app->window_width - dest_rect.w) / 2;
+            dest_rect.y = 0;
+        }
+    } else {
+        // Zoom is capped, so this stays well inside int; drawing clips to the viewport
+        dest_rect.w = (int)(image_width * app->zoom);
+        dest_rect.h = (int)(image_height * app->zoom);
+        
+        if (dest_rect.w <= 0 || dest_rect.h <= 0) {
+            return 0;
+        }
+        
+        dest_rect.x = (int)app->pan_x + (app->window_width - dest_rect.w) / 2;
+        dest_rect.y = (int)app->pan_y + (app->window_height - dest_rect.h) / 2;
+    }
+
+    *out = dest_rect;
+    return 1;
+}
+
+// Preview scaled to the full frame, with decoded full-resolution rows drawn over it
+void render_stream_view(App *app) {
+    const StreamView *view = &app->stream_view;
+    int orientation = view->source->orientation;
+    int swap = orientation_swaps_axes(orientation);
+    SDL_Rect dest_rect;
+    if (!compute_dest_rect(app, swap ? view->source->height : view->source->width,
+                           swap ? view->source->width : view->source->height, &dest_rect)) {
+        return;
+    }
+
+    SDL_Rect frame = orientation_stored_rect(&dest_rect, orientation);
+    SDL_Rect viewport = {0, 0, app->window_width, app->window_height};
+    SDL_Rect clip = orientation_unmap_rect(&viewport, &frame, orientation);
+    SDL_Rect preview_src = {0, 0, 0, 0};
+    if (view->preview && SDL_QueryTexture(view->preview, NULL, NULL, &preview_src.w, &preview_src.h) == 0) {
+        render_copy_clipped(app->renderer, view->preview, &preview_src, &frame, &clip, &frame, orientation);
+    }
+
+    if (view->rows && view->rows_visible > 0) {
+        SDL_Rect src = {0, 0, view->source->width, view->rows_visible};
+        SDL_Rect dest = frame;
+        dest.h = (int)((long long)frame.h * view->rows_visible / view->source->height);
+        render_copy_clipped(app->renderer, view->rows, &src, &dest, &clip, &frame, orientation);
+    }
+}
+
+void render_image(App *app) {
+    if (!app) return;
+
+    if (app->loading && app->stream_view.source &&
+        strcmp(app->stream_view.source->filepath, app->current_path) == 0) {
+        render_stream_view(app);
+        return;
+    }
 
-    if (app->image_texture) {
-        SDL_Rect dest_rect;
+    SDL_Rect dest_rect;
+    int swap = orientation_swaps_axes(app->image_orientation);
+    if (app->image && compute_dest_rect(app, swap ? app->image_height : app->image_width,
+                                        swap ? app->image_width : app->image_height, &dest_rect)) {
+        // Shadow and border are only drawn while the whole image is on screen
+        SDL_Rect viewport = {0, 0, app->window_width, app->window_height};
+        int contained = dest_rect.x >= 0 && dest_rect.y >= 0 && dest_rect.x + dest_rect.w <= viewport.w &&
+                        dest_rect.y + dest_rect.h <= viewport.h;
+
+        // Add subtle shadow effect
+        if (contained) {
+            SDL_SetRenderDrawColor(app->renderer, 0, 0, 0, 50);
+            SDL_Rect shadow_rect = {dest_rect.x + 3, dest_rect.y + 3, dest_rect.w, dest_rect.h};
+            SDL_RenderFillRect(app->renderer, &shadow_rect);
+        }
+        
+        // Render main image, point-sampled once texels are larger than a few screen pixels
+        // EXIF orientation is a transform on the draw, not a rotated copy of the pixels
+        if (!render_animation_frame(app, &dest_rect, &viewport)) {
+            SDL_Rect stored = orientation_stored_rect(&dest_rect, app->image_orientation);
+            const TiledTexture *level = image_pyramid_level(app->image, stored.w, stored.h);
+            int nearest = level && stored.w > level->width * ZOOM_NEAREST_THRESHOLD;
+            tiled_texture_render(app->renderer, level, &stored, &viewport, nearest, app->image_orientation);
+        }
         
-        if (app->fit_to_window) {
-            float aspect_ratio = (float)app->image_width / app->image_height;
-            float window_aspect_ratio = (float)app->window_width / app->window_height;
-
-            if (aspect_ratio > window_aspect_ratio) {
-                dest_rect.w = app->window_width;
-                dest_rect.h = (int)(app->window_width / aspect_ratio);
-                dest_rect.x = 0;
-                dest_rect.y = (app->window_height - dest_rect.h) / 2;
+        // Add elegant border
+        if (contained) {
+            SDL_SetRenderDrawColor(app->renderer, 80, 80, 100, 255);
+            SDL_RenderDrawRect(app->renderer, &dest_rect);
+        }
+    }
+}
+
+void render_info_overlay(App *app) {
+    if (!app || !app->show_info || !app->image) {
+        return;
+    }
+
+    // Anchored bottom-left so it does not sit under the metadata panel
+    int top = app->window_height - 95;
+
+    // Create modern info overlay with glass effect
+    SDL_SetRenderDrawColor(app->renderer, 10, 10, 20, 180);
+    SDL_Rect info_rect = {15, top, 200, 80};
+    SDL_RenderFillRect(app->renderer, &info_rect);
+
+    // Add glass border effect
+    SDL_SetRenderDrawColor(app->renderer, 80, 120, 200, 255);
+    SDL_RenderDrawRect(app->renderer, &info_rect);
+    
+    // Inner highlight
+    SDL_SetRenderDrawColor(app->renderer, 120, 160, 255, 100);
+    SDL_Rect highlight = {17, top + 2, 196, 76};
+    SDL_RenderFillRect(app->renderer, &highlight);
+    
+    // Info text background
+    SDL_SetRenderDrawColor(app->renderer, 30, 30, 40, 200);
+    SDL_Rect text_bg = {22, top + 7, 186, 66};
+    SDL_RenderFillRect(app->renderer, &text_bg);
+    
+    update_overlay_text(app, &app->metadata);
+
+    SDL_Color text_color = {200, 200, 220, 255};
+    for (int i = 0; i < 2; i++) {
+        queue_text(app->renderer, &app->font, 27, top + 12 + i * 20, app->overlay_text.summary_lines[i],
+                   (186 - 10) / GLYPH_WIDTH, text_color);
+    }
+    flush_text(app->renderer, &app->font);
+}
+
+// Hands finished loads to their owners until the frame's upload budget is spent. The first
+// result always goes through so a single large upload cannot stall the ring.
+void drain_loader_results(App *app, double budget_ms) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    ResultSlot slot;
+    while (result_ring_pop(&app->loader.results, &slot)) {
+        if (slot.code == LOADER_EVENT_PROGRESS) {
+            update_stream_view(app, (ProgressiveImage *)slot.data);
+        } else if (slot.code == LOADER_EVENT_THUMBNAIL) {
+            grid_view_receive(app, (ThumbnailResult *)slot.data);
+        } else {
+            complete_image_load(app, (LoadResult *)slot.data);
+        }
+
+        if (stats_elapsed_ms(start) >= budget_ms) {
+            break;
+        }
+    }
+}
+
+void handle_event(App *app, const SDL_Event *event) {
+    // Wake-up only; the results are drained from the ring after the event queue
+    if (app->loader.results.event_type != 0 && event->type == app->loader.results.event_type) {
+        SDL_AtomicSet(&app->loader.results.wake_pending, 0);
+        return;
+    }
+
+    switch (event->type) {
+        case SDL_QUIT:
+            app->running = 0;
+            break;
+        case SDL_WINDOWEVENT:
+            switch (event->window.event) {
+                case SDL_WINDOWEVENT_RESIZED:
+                case SDL_WINDOWEVENT_SIZE_CHANGED:
+                    app->window_width = event->window.data1;
+                    app->window_height = event->window.data2;
+                    app->needs_redraw = 1;
+                    break;
+                case SDL_WINDOWEVENT_EXPOSED:
+                case SDL_WINDOWEVENT_RESTORED:
+                    app->needs_redraw = 1;
+                    break;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+                // Images loaded from here on are converted for the new display; cached ones keep theirs
+                case SDL_WINDOWEVENT_ICCPROF_CHANGED:
+                case SDL_WINDOWEVENT_DISPLAY_CHANGED:
+                    color_manager_update_display(&app->color, app->window);
+                    break;
+#endif
+            }
+            break;
+        case SDL_KEYDOWN:
+            if (app->grid.active) {
+                handle_grid_key(app, event->key.keysym.sym);
+                break;
+            }
+            switch (event->key.keysym.sym) {
+                case SDLK_ESCAPE:
+                    app->running = 0;
+                    break;
+                case SDLK_PLUS:
+                case SDLK_EQUALS:
+                    view_zoom_by(app, ZOOM_KEY_STEP, app->window_width / 2, app->window_height / 2);
+                    break;
+                case SDLK_MINUS:
+                    view_zoom_by(app, 1.0f / ZOOM_KEY_STEP, app->window_width / 2, app->window_height / 2);
+                    break;
+                case SDLK_f:
+                    view_reset(app, 1);
+                    break;
+                case SDLK_1:
+                    view_zoom_to(app, 1.0f, app->window_width / 2, app->window_height / 2);
+                    break;
+                case SDLK_i:
+                    app->show_info = !app->show_info;
+                    app->needs_redraw = 1;
+                    break;
+                // Shift+Left/Right pans; plain Left/Right browse the folder
+                case SDLK_LEFT:
+                    if (event->key.keysym.mod & KMOD_SHIFT) {
+                        view_pan_by(app, (float)(app->window_width / PAN_KEY_DIVISOR), 0.0f, 1);
+                    } else {
+                        navigate_directory(app, -1);
+                    }
+                    break;
+                case SDLK_RIGHT:
+                    if (event->key.keysym.mod & KMOD_SHIFT) {
+                        view_pan_by(app, (float)(-app->window_width / PAN_KEY_DIVISOR), 0.0f, 1);
+                    } else {
+                        navigate_directory(app, 1);
+                    }
+                    break;
+                case SDLK_UP:
+                    view_pan_by(app, 0.0f, (float)(app->window_height / PAN_KEY_DIVISOR), 1);
+                    break;
+                case SDLK_DOWN:
+                    view_pan_by(app, 0.0f, (float)(-app->window_height / PAN_KEY_DIVISOR), 1);
+                    break;
+                case SDLK_g:
+                    grid_view_enter(app);
+                    break;
+                case SDLK_s:
+                    app->show_stats = !app->show_stats;
+                    app->needs_redraw = 1;
+                    break;
+            }
+            break;
+        case SDL_MOUSEBUTTONDOWN:
+            if (event->button.button != SDL_BUTTON_LEFT) {
+                break;
+            }
+            if (app->grid.active) {
+                handle_grid_click(app, event->button.x, event->button.y);
             } else {
-                dest_rect.h = app->window_height;
-                dest_rect.w = (int)(app->window_height * aspect_ratio);
-                dest_rect.x = (app->window_width - dest_rect.w) / 2;
-                dest_rect.y = 0;
+                app->dragging = 1;
+                app->drag_start_x = event->button.x;
+                app->drag_start_y = event->button.y;
             }
-        } else {
-            dest_rect.w = (int)(app->image_width * app->zoom);
-            dest_rect.h = (int)(app->image_height * app->zoom);
-            
-            if (dest_rect.w <= 0 || dest_rect.h <= 0 || 
-                dest_rect.w > 65536 || dest_rect.h > 65536) {
-                return;
+            break;
+        case SDL_MOUSEBUTTONUP:
+            if (event->button.button == SDL_BUTTON_LEFT) {
+                app->dragging = 0;
+            }
+            break;
+        case SDL_MOUSEMOTION:
+            if (!app->dragging || app->grid.active) {
+                break;
+            }
+            if (app->dragging == 1) {
+                int dx = event->motion.x - app->drag_start_x;
+                int dy = event->motion.y - app->drag_start_y;
+                if (SDL_abs(dx) + SDL_abs(dy) < DRAG_THRESHOLD_PX) {
+                    break;
+                }
+                // Catch up on the travel below the threshold
+                app->dragging = 2;
+                view_pan_by(app, (float)dx, (float)dy, 0);
+            } else {
+                view_pan_by(app, (float)event->motion.xrel, (float)event->motion.yrel, 0);
+            }
+            break;
+        case SDL_MOUSEWHEEL:
+            if (app->grid.active) {
+                app->grid.scroll_y -= event->wheel.y * GRID_SCROLL_STEP;
+                grid_clamp_scroll(app);
+                app->needs_redraw = 1;
+            } else if (event->wheel.y != 0) {
+                // Zoom about the cursor
+                int mouse_x, mouse_y;
+                SDL_GetMouseState(&mouse_x, &mouse_y);
+                view_zoom_by(app, event->wheel.y > 0 ? ZOOM_WHEEL_STEP : 1.0f / ZOOM_WHEEL_STEP, mouse_x, mouse_y);
             }
-            
-            dest_rect.x = app->pan_x + (app->window_width - dest_rect.w) / 2;
-            dest_rect.y = app->pan_y + (app->window_height - dest_rect.h) / 2;
+            break;
+    }
+}
+
+void handle_events(App *app, int timeout_ms) {
+    SDL_Event event;
+
+    // Sleep in the event queue while the frame on screen is still valid
+    if (!app->needs_redraw) {
+        if (!SDL_WaitEventTimeout(&event, timeout_ms)) {
+            return;
+        }
+        handle_event(app, &event);
+    }
+
+    while (SDL_PollEvent(&event)) {
+        handle_event(app, &event);
+    }
+}
+
+// Slideshow functions
+void slideshow_destroy(Slideshow *slideshow) {
+    if (slideshow->fade_from) {
+        SDL_DestroyTexture(slideshow->fade_from);
+    }
+    if (slideshow->fade_to) {
+        SDL_DestroyTexture(slideshow->fade_to);
+    }
+    slideshow->fade_from = NULL;
+    slideshow->fade_to = NULL;
+    slideshow->fading = 0;
+}
+
+// Indexes the folder and shows its first image; deadlines start once it is on screen
+int slideshow_start(App *app, const char *directory, Uint32 interval_ms, Uint32 crossfade_ms) {
+    if (!directory_index_open(&app->directory, directory) || app->directory.count == 0) {
+        SDL_Log("No images found for slideshow in %s", directory);
+        return 0;
+    }
+
+    Slideshow *slideshow = &app->slideshow;
+    slideshow->active = 1;
+    slideshow->interval_ms = interval_ms;
+    slideshow->crossfade_ms = SDL_min(crossfade_ms, interval_ms);
+    if (slideshow->crossfade_ms > 0 && !SDL_RenderTargetSupported(app->renderer)) {
+        SDL_Log("Renderer has no render targets; slideshow will cut without crossfade");
+        slideshow->crossfade_ms = 0;
+    }
+
+    SDL_Log("Slideshow of %d images every %u ms", app->directory.count, (unsigned)interval_ms);
+    navigate_directory(app, 0);
+    return 1;
+}
+
+// Draws the current image once into a window-sized target texture
+static int slideshow_snapshot(App *app, SDL_Texture **texture) {
+    int width = 0;
+    int height = 0;
+    if (*texture && (SDL_QueryTexture(*texture, NULL, NULL, &width, &height) != 0 ||
+                     width != app->window_width || height != app->window_height)) {
+        SDL_DestroyTexture(*texture);
+        *texture = NULL;
+    }
+    if (!*texture) {
+        *texture = SDL_CreateTexture(app->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                     app->window_width, app->window_height);
+        if (!*texture) {
+            return 0;
         }
+        SDL_SetTextureBlendMode(*texture, SDL_BLENDMODE_BLEND);
+    }
+
+    if (SDL_SetRenderTarget(app->renderer, *texture) != 0) {
+        return 0;
+    }
+    render_background(app);
+    render_image(app);
+    SDL_SetRenderTarget(app->renderer, NULL);
+    return 1;
+}
+
+static void slideshow_record_late(Slideshow *slideshow, Uint64 late_ms, const char *path) {
+    slideshow->missed++;
+    slideshow->total_late_ms += late_ms;
+    slideshow->worst_late_ms = SDL_max(slideshow->worst_late_ms, late_ms);
+    SDL_Log("Slideshow deadline missed by %llu ms: %s", (unsigned long long)late_ms, path);
+}
+
+// Advances at each deadline: cached images cut or fade in at once, others count as missed
+void slideshow_update(App *app) {
+    Slideshow *slideshow = &app->slideshow;
+    if (!slideshow->active || app->grid.active) {
+        return;
+    }
+
+    Uint64 now = animation_ticks();
+    if (slideshow->fading && now - slideshow->fade_start >= slideshow->crossfade_ms) {
+        slideshow->fading = 0;
+        app->needs_redraw = 1;
+    }
+
+    if (app->loading) {
+        return;
+    }
+    if (slideshow->missed_deadline) {
+        slideshow_record_late(slideshow, now - slideshow->missed_deadline, app->current_path);
+        slideshow->missed_deadline = 0;
+        slideshow->next_deadline = now + slideshow->interval_ms;
+        return;
+    }
+    if (slideshow->next_deadline == 0) {
+        slideshow->shown++;
+        slideshow->next_deadline = now + slideshow->interval_ms;
+        return;
+    }
+    if (now < slideshow->next_deadline || app->directory.count < 2) {
+        return;
+    }
+
+    char path[MAX_PATH_LENGTH];
+    int position = directory_index_step(&app->directory, 1);
+    if (!directory_index_path(&app->directory, position, path, sizeof(path))) {
+        return;
+    }
+
+    int ready = texture_cache_find(app, path) != NULL;
+    int fade = ready && slideshow->crossfade_ms > 0 && slideshow_snapshot(app, &slideshow->fade_from);
+    navigate_directory(app, 1);
+    if (!ready) {
+        // Shown, and its lateness recorded, once the load completes
+        slideshow->missed_deadline = slideshow->next_deadline;
+        return;
+    }
+
+    slideshow->shown++;
+    if (fade && slideshow_snapshot(app, &slideshow->fade_to)) {
+        slideshow->fading = 1;
+        slideshow->fade_start = now;
+    }
 
-        // Add subtle shadow effect
-        SDL_SetRenderDrawColor(app->renderer, 0, 0, 0, 50);
-        SDL_Rect shadow_rect = {dest_rect.x + 3, dest_rect.y + 3, dest_rect.w, dest_rect.h};
-        SDL_RenderFillRect(app->renderer, &shadow_rect);
-        
-        // Render main image
-        SDL_RenderCopy(app->renderer, app->image_texture, NULL, &dest_rect);
-        
-        // Add elegant border
-        SDL_SetRenderDrawColor(app->renderer, 80, 80, 100, 255);
-        SDL_RenderDrawRect(app->renderer, &dest_rect);
+    // Deadlines advance from the previous one, so wake-up jitter does not accumulate
+    slideshow->next_deadline += slideshow->interval_ms;
+    if (slideshow->next_deadline <= now) {
+        slideshow->next_deadline = now + slideshow->interval_ms;
     }
 }
 
-void render_info_overlay(App *app) {
-    if (!app || !app->show_info || !app->image_texture) {
-        return;
+// Blends the two snapshots; the source pyramids are not drawn again while fading
+int render_slideshow_fade(App *app) {
+    Slideshow *slideshow = &app->slideshow;
+    if (!slideshow->fading) {
+        return 0;
     }
 
-    // Create modern info overlay with glass effect
-    SDL_SetRenderDrawColor(app->renderer, 10, 10, 20, 180);
-    SDL_Rect info_rect = {15, 15, 200, 80};
-    SDL_RenderFillRect(app->renderer, &info_rect);
+    Uint64 elapsed = animation_ticks() - slideshow->fade_start;
+    Uint8 alpha = (Uint8)SDL_min(255, elapsed * 255 / SDL_max(slideshow->crossfade_ms, 1u));
+    SDL_SetTextureAlphaMod(slideshow->fade_to, alpha);
+    SDL_RenderCopy(app->renderer, slideshow->fade_from, NULL, NULL);
+    SDL_RenderCopy(app->renderer, slideshow->fade_to, NULL, NULL);
+    app->needs_redraw = 1;
+    return 1;
+}
 
-    // Add glass border effect
-    SDL_SetRenderDrawColor(app->renderer, 80, 120, 200, 255);
-    SDL_RenderDrawRect(app->renderer, &info_rect);
-    
-    // Inner highlight
-    SDL_SetRenderDrawColor(app->renderer, 120, 160, 255, 100);
-    SDL_Rect highlight = {17, 17, 196, 76};
-    SDL_RenderFillRect(app->renderer, &highlight);
-    
-    // Info text background
-    SDL_SetRenderDrawColor(app->renderer, 30, 30, 40, 200);
-    SDL_Rect text_bg = {22, 22, 186, 66};
-    SDL_RenderFillRect(app->renderer, &text_bg);
-    
-    // Simulated text indicators
-    SDL_SetRenderDrawColor(app->renderer, 200, 200, 220, 255);
-    SDL_Rect text_indicators[] = {
-        {25, 25, 60, 8},   // "Image:"
-        {90, 25, 40, 8},   // "Info"
-        {130, 25, 80, 8},  // dimensions
-        {25, 45, 60, 8},   // "Size:"
-        {90, 45, 40, 8},   // "Zoom:"
-        {130, 45, 40, 8}   // zoom value
-    };
-    
-    for (int i = 0; i < 6; i++) {
-        SDL_RenderFillRect(app->renderer, &text_indicators[i]);
+int slideshow_wait_ms(const App *app) {
+    const Slideshow *slideshow = &app->slideshow;
+    if (!slideshow->active || slideshow->next_deadline == 0 || slideshow->missed_deadline || app->loading) {
+        return EVENT_WAIT_TIMEOUT_MS;
     }
-    
-    char info_text[256];
-    secure_strncpy(info_text, "", sizeof(info_text));
-    snprintf(info_text, sizeof(info_text), "Image: %dx%d | Zoom: %.1fx", 
-            app->image_width, app->image_height, app->zoom);
-    
-    SDL_Log("Info: %s", info_text);
-    secure_memzero(info_text, sizeof(info_text));
+
+    Uint64 now = animation_ticks();
+    return slideshow->next_deadline <= now ? 0 :
+           (int)SDL_min(slideshow->next_deadline - now, (Uint64)EVENT_WAIT_TIMEOUT_MS);
 }
 
-void handle_events(App *app) {
-    SDL_Event event;
-    while (SDL_PollEvent(&event)) {
-        switch (event.type) {
-            case SDL_QUIT:
-                app->running = 0;
-                break;
-            case SDL_WINDOWEVENT:
-                if (event.window.event == SDL_WINDOWEVENT_RESIZED) {
-                    app->window_width = event.window.data1;
-                    app->window_height = event.window.data2;
-                }
-                break;
-            case SDL_KEYDOWN:
-                switch (event.key.keysym.sym) {
-                    case SDLK_ESCAPE:
-                        app->running = 0;
-                        break;
-                    case SDLK_PLUS:
-                    case SDLK_EQUALS:
-                        app->zoom *= 1.2f;
-                        app->fit_to_window = 0;
-                        break;
-                    case SDLK_MINUS:
-                        app->zoom /= 1.2f;
-                        app->fit_to_window = 0;
-                        break;
-                    case SDLK_f:
-                        app->fit_to_window = 1;
-                        app->zoom = 1.0f;
-                        app->pan_x = 0;
-                        app->pan_y = 0;
-                        break;
-                    case SDLK_1:
-                        app->fit_to_window = 0;
-                        app->zoom = 1.0f;
-                        app->pan_x = 0;
-                        app->pan_y = 0;
-                        break;
-                    case SDLK_i:
-                        app->show_info = !app->show_info;
-                        break;
-                    case SDLK_LEFT:
-                        break;
-                    case SDLK_RIGHT:
-                        break;
-                }
-                break;
-            case SDL_MOUSEWHEEL:
-                if (event.wheel.y > 0) {
-                    app->zoom *= 1.1f;
-                    app->fit_to_window = 0;
-                } else if (event.wheel.y < 0) {
-                    app->zoom /= 1.1f;
-                    app->fit_to_window = 0;
-                }
-                break;
-        }
+void slideshow_report(const Slideshow *slideshow) {
+    if (!slideshow->active) {
+        return;
     }
+
+    SDL_Log("Slideshow: %d images shown, %d deadlines missed, mean %llu ms late, worst %llu ms",
+            slideshow->shown, slideshow->missed,
+            (unsigned long long)(slideshow->missed ? slideshow->total_late_ms / slideshow->missed : 0),
+            (unsigned long long)slideshow->worst_late_ms);
 }
 
 // Main application functions
@@ -615,7 +8155,7 @@ int initialize_sdl(App *app) {
         SDL_WINDOWPOS_CENTERED,
         WINDOW_WIDTH,
         WINDOW_HEIGHT,
-        SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI
+        app->benchmark ? SDL_WINDOW_HIDDEN : SDL_WINDOW_RESIZABLE | SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI
     );
 
     if (!app->window) {
@@ -625,10 +8165,11 @@ int initialize_sdl(App *app) {
         return 0;
     }
 
+    // Benchmarks run on the software renderer so the dummy video driver works and vsync does not cap frames
     app->renderer = SDL_CreateRenderer(
         app->window,
         -1,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
+        app->benchmark ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC
     );
 
     if (!app->renderer) {
@@ -639,16 +8180,67 @@ int initialize_sdl(App *app) {
         return 0;
     }
 
+    SDL_RendererInfo renderer_info;
+    if (SDL_GetRendererInfo(app->renderer, &renderer_info) == 0) {
+        app->max_texture_width = renderer_info.max_texture_width;
+        app->max_texture_height = renderer_info.max_texture_height;
+        app->texture_formats.count = (int)SDL_min(renderer_info.num_texture_formats, 16u);
+        for (int i = 0; i < app->texture_formats.count; i++) {
+            app->texture_formats.formats[i] = renderer_info.texture_formats[i];
+        }
+    } else {
+        app->max_texture_width = 0;
+        app->max_texture_height = 0;
+    }
+
+    // Textures default to bilinear; render_image switches to nearest for strong magnification
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
+
+    // Overlays and the image shadow are drawn with translucent colors
+    SDL_SetRenderDrawBlendMode(app->renderer, SDL_BLENDMODE_BLEND);
+
+    if (!glyph_atlas_create(app->renderer, &app->font)) {
+        SDL_Log("Failed to create overlay font: %s", SDL_GetError());
+    }
+
+    // Without a lock the loader leaves pixels as decoded
+    if (color_manager_init(&app->color)) {
+        color_manager_update_display(&app->color, app->window);
+    }
+
     SDL_GetWindowSize(app->window, &app->window_width, &app->window_height);
-    app->image_texture = NULL;
+    app->image = NULL;
     app->image_width = 0;
     app->image_height = 0;
+    app->image_orientation = 1;
     app->running = 1;
     app->zoom = 1.0f;
-    app->pan_x = 0;
-    app->pan_y = 0;
+    app->pan_x = 0.0f;
+    app->pan_y = 0.0f;
     app->fit_to_window = 1;
     app->show_info = 0;
+    app->needs_redraw = 1;
+    app->loading = 0;
+
+    // Runs without a thumbnail cache when no cache directory can be created
+    thumbnail_cache_init(&app->thumbnails);
+
+    // The loader thread joins in on its own decodes, so one core is left for it
+    if (!pixel_pool_init(&app->pixel_pool, app->memory.cpu_cap / PIXEL_POOL_IDLE_SHARE) ||
+        !worker_pool_start(&app->decode_workers, SDL_GetCPUCount() - 1) ||
+        !image_loader_start(&app->loader, &app->pixel_pool, &app->decode_workers, &app->thumbnails,
+                            &app->memory, &app->color)) {
+        image_loader_stop(&app->loader);
+        worker_pool_stop(&app->decode_workers);
+        pixel_pool_destroy(&app->pixel_pool);
+        color_manager_destroy(&app->color);
+        glyph_atlas_destroy(&app->font);
+        SDL_DestroyRenderer(app->renderer);
+        SDL_DestroyWindow(app->window);
+        IMG_Quit();
+        SDL_Quit();
+        return 0;
+    }
 
     return 1;
 }
@@ -656,10 +8248,12 @@ int initialize_sdl(App *app) {
 void cleanup(App *app) {
     if (!app) return;
     
-    if (app->image_texture) {
-        SDL_DestroyTexture(app->image_texture);
-        app->image_texture = NULL;
-    }
+    texture_cache_clear(app);
+    slideshow_destroy(&app->slideshow);
+    stream_view_reset(&app->stream_view);
+    animation_player_close(&app->player);
+    grid_view_destroy(&app->grid);
+    glyph_atlas_destroy(&app->font);
     if (app->renderer) {
         SDL_DestroyRenderer(app->renderer);
         app->renderer = NULL;
@@ -668,55 +8262,699 @@ void cleanup(App *app) {
         SDL_DestroyWindow(app->window);
         app->window = NULL;
     }
-    
+
+    image_loader_stop(&app->loader);
+    worker_pool_stop(&app->decode_workers);
+    pixel_pool_destroy(&app->pixel_pool);
+    color_manager_destroy(&app->color);
+    directory_watch_stop(&app->watcher);
+    directory_index_free(&app->directory);
+
     secure_memzero(app, sizeof(App));
     IMG_Quit();
     SDL_Quit();
 }
 
+void render_overlays(App *app) {
+    if (app->loading && !app->stream_view.source) {
+        render_loading_placeholder(app);
+    }
+
+    if (app->show_info && app->image) {
+        render_info_overlay(app);
+        render_metadata_overlay(app, &app->metadata);
+    }
+}
+
+// How long the event loop may sleep before a zoom/pan step, GIF frame or slide is due;
+// results left over from the last upload budget are taken on the next pass without sleeping
+int next_wake_ms(App *app) {
+    if (result_ring_pending(&app->loader.results)) {
+        return 0;
+    }
+
+    int timeout = app->animation.active ? (int)ANIMATION_STEP_MS : EVENT_WAIT_TIMEOUT_MS;
+    timeout = SDL_min(timeout, animation_player_wait_ms(app));
+    timeout = SDL_min(timeout, directory_watch_wait_ms(app));
+    return SDL_min(timeout, slideshow_wait_ms(app));
+}
+
+// One frame: background, image, overlays, then a single present, each half timed
 void render(App *app) {
-    render_image(app);
-    render_info_overlay(app);
+    if (!app) return;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    render_background(app);
+    if (app->grid.active) {
+        render_grid(app);
+    } else if (!render_slideshow_fade(app)) {
+        render_image(app);
+        render_overlays(app);
+    }
+    render_stats_overlay(app);
+    stats_record(&app->stats, STATS_STAGE_RENDER, stats_elapsed_ms(start));
+
+    start = SDL_GetPerformanceCounter();
     SDL_RenderPresent(app->renderer);
+    stats_record(&app->stats, STATS_STAGE_PRESENT, stats_elapsed_ms(start));
+}
+
+// Batch scan functions
+typedef struct {
+    char (*paths)[MAX_PATH_LENGTH];
+    int count;
+    int total;
+    int json;
+    int thumbnails;
+    PixelPool *pool;
+    ThumbnailCache *cache;
+    WorkerPool *workers;
+    SDL_mutex *output_lock;
+    SDL_atomic_t invalid;
+} ScanJob;
+
+static const char *security_result_name(SecurityResult result) {
+    switch (result) {
+        case SECURITY_OK: return "ok";
+        case SECURITY_ERROR_INVALID_INPUT: return "invalid input";
+        case SECURITY_ERROR_PATH_TOO_LONG: return "path too long";
+        case SECURITY_ERROR_FILE_TOO_LARGE: return "file too large";
+        case SECURITY_ERROR_ACCESS_DENIED: return "access denied";
+        case SECURITY_ERROR_MEMORY_ALLOCATION: return "out of memory";
+    }
+    return "unknown";
+}
+
+// Appends a JSON string literal; bytes above 0x7F are passed through as UTF-8
+static size_t json_append_string(char *out, size_t pos, size_t out_size, const char *text) {
+    if (pos + 1 < out_size) {
+        out[pos++] = '"';
+    }
+    for (const unsigned char *c = (const unsigned char *)text; *c && pos + 7 < out_size; c++) {
+        if (*c == '"' || *c == '\\') {
+            out[pos++] = '\\';
+            out[pos++] = (char)*c;
+        } else if (*c < 0x20) {
+            pos += (size_t)snprintf(out + pos, out_size - pos, "\\u%04x", *c);
+        } else {
+            out[pos++] = (char)*c;
+        }
+    }
+    if (pos + 1 < out_size) {
+        out[pos++] = '"';
+    }
+    out[pos] = '\0';
+    return pos;
+}
+
+// Decodes and caches a thumbnail unless the cached one still matches the file
+static void scan_store_thumbnail(ScanJob *job, const MappedFile *file, const ImageMetadata *metadata) {
+    if (thumbnail_cache_lookup(job->cache, metadata->filepath, file->modification_time, (long)file->size, NULL)) {
+        return;
+    }
+
+    SDL_Surface *levels[MAX_MIP_LEVELS] = {0};
+    if (!decode_image_reduced(file, metadata, job->pool, THUMBNAIL_SIZE, THUMBNAIL_SIZE, &levels[0]) &&
+        decode_image_mapped(file, metadata->filepath, &levels[0]) != SECURITY_OK) {
+        return;
+    }
+
+    int level_count = build_mip_levels(job->pool, levels, MAX_MIP_LEVELS);
+    SDL_Surface *thumbnail = create_thumbnail(job->pool, levels, level_count);
+    thumbnail_cache_store(job->cache, metadata->filepath, metadata, thumbnail);
+    release_surface(thumbnail);
+    free_surface_levels(levels, level_count);
+}
+
+// One file: path and size checks, then the header probe; each record is written whole
+static void scan_file_task(void *context, int index) {
+    ScanJob *job = (ScanJob *)context;
+    const char *path = job->paths[index];
+
+    ImageMetadata metadata;
+    secure_memzero(&metadata, sizeof(metadata));
+    secure_strncpy(metadata.filepath, path, sizeof(metadata.filepath));
+
+    MappedFile file;
+    const char *error = NULL;
+    SecurityResult result = validate_filepath(path);
+    if (result == SECURITY_OK) {
+        // map_file applies validate_image_size to the size it stats
+        result = map_file(path, &file);
+    }
+    if (result != SECURITY_OK) {
+        error = security_result_name(result);
+    } else {
+        if (!extract_metadata_mapped(path, &file, &metadata)) {
+            error = "invalid file name";
+        } else if (metadata.width <= 0 || metadata.height <= 0) {
+            error = "unrecognised image header";
+        } else if (job->thumbnails) {
+            scan_store_thumbnail(job, &file, &metadata);
+        }
+        unmap_file(&file);
+    }
+    if (error) {
+        SDL_AtomicAdd(&job->invalid, 1);
+    }
+
+    char record[MAX_PATH_LENGTH * 2 + 1024];
+    size_t pos = 0;
+    if (job->json) {
+        pos = (size_t)snprintf(record, sizeof(record), "{\"path\":");
+        pos = json_append_string(record, pos, sizeof(record), path);
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"valid\":%s", error ? "false" : "true");
+        if (error) {
+            pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"error\":");
+            pos = json_append_string(record, pos, sizeof(record), error);
+        }
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"filename\":");
+        pos = json_append_string(record, pos, sizeof(record), metadata.filename);
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"format\":");
+        pos = json_append_string(record, pos, sizeof(record), metadata.format);
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"color_space\":");
+        pos = json_append_string(record, pos, sizeof(record), metadata.color_space);
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"camera_make\":");
+        pos = json_append_string(record, pos, sizeof(record), metadata.camera_make);
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos, ",\"camera_model\":");
+        pos = json_append_string(record, pos, sizeof(record), metadata.camera_model);
+        pos += (size_t)snprintf(record + pos, sizeof(record) - pos,
+                                ",\"width\":%d,\"height\":%d,\"bits_per_pixel\":%d,\"orientation\":%d,"
+                                "\"file_size\":%ld,\"capture_time\":%lld,\"creation_time\":%lld,"
+                                "\"modification_time\":%lld}\n",
+                                metadata.width, metadata.height, metadata.bits_per_pixel, metadata.orientation,
+                                metadata.file_size, (long long)metadata.capture_time,
+                                (long long)metadata.creation_time, (long long)metadata.modification_time);
+    } else {
+        pos = (size_t)snprintf(record, sizeof(record), "%s\t%s\t%dx%d\t%ld\t%s\n", error ? "INVALID" : "OK",
+                               metadata.format[0] ? metadata.format : "-", metadata.width, metadata.height,
+                               metadata.file_size, path);
+    }
+
+    SDL_LockMutex(job->output_lock);
+    fwrite(record, 1, SDL_min(pos, sizeof(record) - 1), stdout);
+    SDL_UnlockMutex(job->output_lock);
+}
+
+static void scan_flush(ScanJob *job) {
+    if (job->count == 0) {
+        return;
+    }
+
+    worker_pool_run(job->workers, scan_file_task, job, job->count);
+    fflush(stdout);
+    job->total += job->count;
+    job->count = 0;
+}
+
+// Depth-first walk; symlinked directories are not followed so a link cycle cannot recurse
+static void scan_directory(ScanJob *job, const char *directory, int depth) {
+    DIR *dir = opendir(directory);
+    if (!dir) {
+        SDL_Log("Cannot open %s", directory);
+        return;
+    }
+
+    struct dirent *dirent_entry;
+    while ((dirent_entry = readdir(dir)) != NULL) {
+        const char *name = dirent_entry->d_name;
+        if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0) {
+            continue;
+        }
+
+        char path[MAX_PATH_LENGTH];
+        struct stat file_stat;
+        if (!join_path(path, sizeof(path), directory, name)) {
+            continue;
+        }
+#ifdef _WIN32
+        if (stat(path, &file_stat) != 0) {
+            continue;
+        }
+#else
+        // Links are not followed into directories, which could loop, but linked files are scanned
+        if (lstat(path, &file_stat) != 0 || (S_ISLNK(file_stat.st_mode) &&
+                                             (stat(path, &file_stat) != 0 || S_ISDIR(file_stat.st_mode)))) {
+            continue;
+        }
+#endif
+
+        if (S_ISDIR(file_stat.st_mode)) {
+            if (depth < SCAN_MAX_DEPTH) {
+                scan_directory(job, path, depth + 1);
+            }
+        } else if (S_ISREG(file_stat.st_mode) && strcmp(get_format_name(name), "Unknown") != 0) {
+            memcpy(job->paths[job->count++], path, sizeof(path));
+            if (job->count == SCAN_BATCH_FILES) {
+                scan_flush(job);
+            }
+        }
+    }
+    closedir(dir);
+}
+
+// Windowless ingest check over a tree; returns non-zero when any file failed validation
+int run_scan(const char *directory, int jobs, int json, int thumbnails, size_t cpu_budget_mb) {
+    ScanJob job;
+    secure_memzero(&job, sizeof(job));
+    job.json = json;
+    job.thumbnails = thumbnails;
+
+    PixelPool pool;
+    WorkerPool workers;
+    ThumbnailCache cache;
+    secure_memzero(&pool, sizeof(pool));
+    secure_memzero(&workers, sizeof(workers));
+    job.output_lock = SDL_CreateMutex();
+    if (!job.output_lock ||
+        safe_malloc_uninitialized((void **)&job.paths, (size_t)SCAN_BATCH_FILES * MAX_PATH_LENGTH) != SECURITY_OK ||
+        !pixel_pool_init(&pool, memory_budget_bytes(cpu_budget_mb) / PIXEL_POOL_IDLE_SHARE) ||
+        !worker_pool_start(&workers, jobs - 1)) {
+        SDL_Log("Failed to start scan");
+        pixel_pool_destroy(&pool);
+        safe_free((void **)&job.paths);
+        if (job.output_lock) {
+            SDL_DestroyMutex(job.output_lock);
+        }
+        return 1;
+    }
+    job.pool = &pool;
+    job.workers = &workers;
+    if (thumbnails && thumbnail_cache_init(&cache)) {
+        job.cache = &cache;
+    } else {
+        job.thumbnails = 0;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    scan_directory(&job, directory, 0);
+    scan_flush(&job);
+    double elapsed_ms = stats_elapsed_ms(start);
+
+    int invalid = SDL_AtomicGet(&job.invalid);
+    SDL_Log("Scanned %d files (%d invalid) in %.0f ms, %.0f files/min with %d jobs", job.total, invalid, elapsed_ms,
+            elapsed_ms > 0.0 ? job.total * 60000.0 / elapsed_ms : 0.0, workers.thread_count + 1);
+
+    worker_pool_stop(&workers);
+    pixel_pool_destroy(&pool);
+    safe_free((void **)&job.paths);
+    SDL_DestroyMutex(job.output_lock);
+    return invalid == 0 ? 0 : 1;
+}
+
+// Benchmark functions
+typedef enum {
+    BENCH_FORMAT_PNG,
+    BENCH_FORMAT_JPEG,
+    BENCH_FORMAT_BMP
+} BenchFormat;
+
+typedef struct {
+    const char *name;
+    int width;
+    int height;
+    int bits_per_pixel; // 8 is a grey palette, 32 carries alpha
+    BenchFormat format;
+} BenchImage;
+
+// Keep in sync with BENCH_FILES in the Makefile, which bench-clean removes
+static const BenchImage bench_corpus[] = {
+    {"palette_640x480.png", 640, 480, 8, BENCH_FORMAT_PNG},
+    {"rgb_640x480.bmp", 640, 480, 24, BENCH_FORMAT_BMP},
+    {"rgb_1920x1080.jpg", 1920, 1080, 24, BENCH_FORMAT_JPEG},
+    {"rgba_1920x1080.png", 1920, 1080, 32, BENCH_FORMAT_PNG},
+    {"rgba_2048x2048.bmp", 2048, 2048, 32, BENCH_FORMAT_BMP},
+    {"grey_4000x3000.png", 4000, 3000, 8, BENCH_FORMAT_PNG},
+    {"rgb_4000x3000.jpg", 4000, 3000, 24, BENCH_FORMAT_JPEG},
+    {"rgb_6000x4000.jpg", 6000, 4000, 24, BENCH_FORMAT_JPEG}
+};
+
+static const float bench_zoom_levels[] = {0.0f, 0.25f, 1.0f, 2.0f}; // 0 means fit to window
+
+// Gradients plus a little noise, so encoders neither collapse the data nor blow up on it
+static SDL_Surface *bench_create_surface(const BenchImage *spec) {
+    Uint32 format = spec->bits_per_pixel == 8 ? SDL_PIXELFORMAT_INDEX8 :
+                    spec->bits_per_pixel == 24 ? SDL_PIXELFORMAT_RGB24 : SDL_PIXELFORMAT_RGBA32;
+    SDL_Surface *surface = SDL_CreateRGBSurfaceWithFormat(0, spec->width, spec->height, spec->bits_per_pixel,
+                                                          format);
+    if (!surface) {
+        return NULL;
+    }
+
+    if (spec->bits_per_pixel == 8) {
+        SDL_Color grey[256];
+        for (int i = 0; i < 256; i++) {
+            grey[i].r = grey[i].g = grey[i].b = (Uint8)i;
+            grey[i].a = 255;
+        }
+        SDL_SetPaletteColors(surface->format->palette, grey, 0, 256);
+    }
+
+    Uint32 noise = 0x9E3779B9u;
+    int channels = spec->bits_per_pixel / 8;
+    for (int y = 0; y < spec->height; y++) {
+        Uint8 *row = (Uint8 *)surface->pixels + (size_t)y * surface->pitch;
+        for (int x = 0; x < spec->width; x++) {
+            noise ^= noise << 13;
+            noise ^= noise >> 17;
+            noise ^= noise << 5;
+            int jitter = (int)(noise & 15) - 8;
+            Uint8 *pixel = row + (size_t)x * channels;
+            pixel[0] = (Uint8)SDL_max(0, SDL_min(255, x * 255 / spec->width + jitter));
+            if (channels >= 3) {
+                pixel[1] = (Uint8)SDL_max(0, SDL_min(255, y * 255 / spec->height + jitter));
+                pixel[2] = (Uint8)((x ^ y) & 0xFF);
+            }
+            if (channels == 4) {
+                pixel[3] = (Uint8)(192 + ((x + y) & 63));
+            }
+        }
+    }
+
+    return surface;
+}
+
+static int bench_save_surface(SDL_Surface *surface, BenchFormat format, const char *path) {
+    switch (format) {
+        case BENCH_FORMAT_PNG:
+            return IMG_SavePNG(surface, path) == 0;
+        case BENCH_FORMAT_JPEG:
+#if SDL_IMAGE_VERSION_ATLEAST(2, 0, 2)
+            return IMG_SaveJPG(surface, path, 90) == 0;
+#else
+            return 0;
+#endif
+        case BENCH_FORMAT_BMP:
+            return SDL_SaveBMP(surface, path) == 0;
+    }
+    return 0;
+}
+
+// Writes any corpus files that are missing; existing files are reused so runs stay comparable
+int bench_generate_corpus(const char *directory) {
+    char directory_path[MAX_PATH_LENGTH];
+    secure_strncpy(directory_path, directory, sizeof(directory_path));
+    if (!make_directories(directory_path)) {
+        SDL_Log("Failed to create benchmark corpus directory %s", directory);
+        return 0;
+    }
+
+    for (size_t i = 0; i < SDL_arraysize(bench_corpus); i++) {
+        char path[MAX_PATH_LENGTH];
+        struct stat file_stat;
+        if (!join_path(path, sizeof(path), directory, bench_corpus[i].name)) {
+            return 0;
+        }
+        if (stat(path, &file_stat) == 0) {
+            continue;
+        }
+
+        SDL_Surface *surface = bench_create_surface(&bench_corpus[i]);
+        int saved = surface && bench_save_surface(surface, bench_corpus[i].format, path);
+        SDL_FreeSurface(surface);
+        if (!saved) {
+            SDL_Log("Failed to generate %s: %s", path, SDL_GetError());
+            return 0;
+        }
+        SDL_Log("Generated %s", path);
+    }
+
+    return 1;
+}
+
+static void bench_summarize(float *samples, int count, double *p50, double *p99, double *mean) {
+    double total = 0.0;
+    for (int i = 0; i < count; i++) {
+        total += samples[i];
+    }
+    qsort(samples, (size_t)count, sizeof(float), compare_floats);
+    *p50 = percentile_sorted(samples, count, 50);
+    *p99 = percentile_sorted(samples, count, 99);
+    *mean = total / count;
+}
+
+// Loads every corpus image cold, then renders it at each zoom level; returns the process exit code
+int run_benchmark(App *app, const char *directory, int frames) {
+    if (!bench_generate_corpus(directory)) {
+        return 1;
+    }
+
+    float load_ms[BENCH_LOAD_ITERATIONS];
+    float metadata_ms[BENCH_LOAD_ITERATIONS];
+    float *zoom_ms[SDL_arraysize(bench_zoom_levels)] = {0};
+    int zoom_samples = 0;
+    int failures = 0;
+
+    for (size_t z = 0; z < SDL_arraysize(bench_zoom_levels); z++) {
+        if (safe_malloc_uninitialized((void **)&zoom_ms[z], SDL_arraysize(bench_corpus) * (size_t)frames *
+                                      sizeof(float)) != SECURITY_OK) {
+            SDL_Log("Failed to allocate benchmark samples");
+            failures++;
+        }
+    }
+
+    SDL_RendererInfo renderer_info;
+    SDL_version version;
+    SDL_GetVersion(&version);
+    printf("Photon benchmark: SDL %d.%d.%d, renderer %s, %d frames per zoom level\n\n", version.major,
+           version.minor, version.patch,
+           SDL_GetRendererInfo(app->renderer, &renderer_info) == 0 ? renderer_info.name : "unknown", frames);
+    printf("%-22s %11s %10s %10s %10s %9s\n", "image", "size", "meta p50", "load p50", "load p99", "MP/s");
+
+    for (size_t i = 0; i < SDL_arraysize(bench_corpus) && failures == 0; i++) {
+        const BenchImage *spec = &bench_corpus[i];
+        char path[MAX_PATH_LENGTH];
+        if (!join_path(path, sizeof(path), directory, spec->name)) {
+            failures++;
+            break;
+        }
+
+        for (int iteration = 0; iteration < BENCH_LOAD_ITERATIONS; iteration++) {
+            ImageMetadata metadata;
+            secure_memzero(&metadata, sizeof(metadata));
+            Uint64 start = SDL_GetPerformanceCounter();
+            extract_metadata(path, &metadata);
+            metadata_ms[iteration] = (float)stats_elapsed_ms(start);
+
+            // Every load starts from an empty texture cache so uploads are not recycled
+            texture_cache_clear(app);
+            app->image = NULL;
+            start = SDL_GetPerformanceCounter();
+            SecurityResult result = load_image_secure(app, path);
+            load_ms[iteration] = (float)stats_elapsed_ms(start);
+            if (result != SECURITY_OK) {
+                SDL_Log("Benchmark load failed: %s", path);
+                failures++;
+                break;
+            }
+        }
+        if (failures > 0) {
+            break;
+        }
+
+        double meta_p50, meta_p99, meta_mean, load_p50, load_p99, load_mean;
+        bench_summarize(metadata_ms, BENCH_LOAD_ITERATIONS, &meta_p50, &meta_p99, &meta_mean);
+        bench_summarize(load_ms, BENCH_LOAD_ITERATIONS, &load_p50, &load_p99, &load_mean);
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", spec->width, spec->height);
+        printf("%-22s %11s %8.2fms %8.2fms %8.2fms %9.1f\n", spec->name, size, meta_p50, load_p50, load_p99,
+               (double)spec->width * spec->height / 1e6 / (load_mean / 1000.0));
+
+        for (size_t z = 0; z < SDL_arraysize(bench_zoom_levels); z++) {
+            app->fit_to_window = bench_zoom_levels[z] == 0.0f;
+            app->zoom = app->fit_to_window ? 1.0f : bench_zoom_levels[z];
+            app->pan_x = 0.0f;
+            app->pan_y = 0.0f;
+            for (int frame = 0; frame < frames; frame++) {
+                Uint64 start = SDL_GetPerformanceCounter();
+                render(app);
+                zoom_ms[z][zoom_samples + frame] = (float)stats_elapsed_ms(start);
+            }
+        }
+        zoom_samples += frames;
+    }
+
+    if (failures == 0) {
+        printf("\n%-22s %10s %10s %10s\n", "zoom", "frame p50", "frame p99", "fps");
+        for (size_t z = 0; z < SDL_arraysize(bench_zoom_levels); z++) {
+            double p50, p99, mean;
+            bench_summarize(zoom_ms[z], zoom_samples, &p50, &p99, &mean);
+            char label[32];
+            if (bench_zoom_levels[z] == 0.0f) {
+                snprintf(label, sizeof(label), "fit");
+            } else {
+                snprintf(label, sizeof(label), "%.0f%%", bench_zoom_levels[z] * 100.0f);
+            }
+            printf("%-22s %8.2fms %8.2fms %10.1f\n", label, p50, p99, 1000.0 / mean);
+        }
+    }
+
+    for (size_t z = 0; z < SDL_arraysize(bench_zoom_levels); z++) {
+        safe_free((void **)&zoom_ms[z]);
+    }
+    return failures == 0 ? 0 : 1;
 }
 
 int main(int argc, char *argv[]) {
     App app = {0};
-    ImageMetadata metadata = {0};
+    const char *image_path = NULL;
+    const char *bench_directory = NULL;
+    int bench_frames = BENCH_DEFAULT_FRAMES;
+    const char *slideshow_directory = NULL;
+    long slideshow_interval = SLIDESHOW_DEFAULT_INTERVAL_MS;
+    long slideshow_crossfade = 0;
+    const char *scan_directory_path = NULL;
+    int scan_jobs = SDL_GetCPUCount();
+    int scan_json = 0;
+    int scan_thumbnails = 0;
+    long cpu_budget_mb = MEMORY_DEFAULT_CPU_BUDGET_MB;
+    long gpu_budget_mb = MEMORY_DEFAULT_GPU_BUDGET_MB;
 
+    // --stats shows the timing panel from the start and writes a CSV summary on exit
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            secure_strncpy(app.stats.csv_path, STATS_DEFAULT_CSV, sizeof(app.stats.csv_path));
+            app.show_stats = 1;
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            if (validate_filepath(argv[i] + 8) != SECURITY_OK) {
+                SDL_Log("Security error: Invalid stats path");
+                return 1;
+            }
+            secure_strncpy(app.stats.csv_path, argv[i] + 8, sizeof(app.stats.csv_path));
+            app.show_stats = 1;
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            // Optional corpus directory follows
+            app.benchmark = 1;
+            bench_directory = BENCH_DEFAULT_CORPUS;
+            if (i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0) {
+                bench_directory = argv[++i];
+            }
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            bench_frames = atoi(argv[++i]);
+            if (bench_frames < 1 || bench_frames > BENCH_MAX_FRAMES) {
+                SDL_Log("--frames must be between 1 and %d", BENCH_MAX_FRAMES);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--slideshow") == 0 && i + 1 < argc) {
+            slideshow_directory = argv[++i];
+        } else if (strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            slideshow_interval = atol(argv[++i]);
+            if (slideshow_interval < SLIDESHOW_MIN_INTERVAL_MS || slideshow_interval > SLIDESHOW_MAX_INTERVAL_MS) {
+                SDL_Log("--interval must be between %d and %ld ms", SLIDESHOW_MIN_INTERVAL_MS,
+                        SLIDESHOW_MAX_INTERVAL_MS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--crossfade") == 0 && i + 1 < argc) {
+            slideshow_crossfade = atol(argv[++i]);
+            if (slideshow_crossfade < 0 || slideshow_crossfade > SLIDESHOW_MAX_CROSSFADE_MS) {
+                SDL_Log("--crossfade must be between 0 and %d ms", SLIDESHOW_MAX_CROSSFADE_MS);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--scan") == 0 && i + 1 < argc) {
+            scan_directory_path = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            scan_jobs = atoi(argv[++i]);
+            if (scan_jobs < 1 || scan_jobs > MAX_WORKER_THREADS + 1) {
+                SDL_Log("--jobs must be between 1 and %d", MAX_WORKER_THREADS + 1);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--cpu-budget") == 0 && i + 1 < argc) {
+            cpu_budget_mb = atol(argv[++i]);
+            if (cpu_budget_mb < MEMORY_MIN_BUDGET_MB || cpu_budget_mb > MEMORY_MAX_BUDGET_MB) {
+                SDL_Log("--cpu-budget must be between %d and %ld MiB", MEMORY_MIN_BUDGET_MB, MEMORY_MAX_BUDGET_MB);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc) {
+            gpu_budget_mb = atol(argv[++i]);
+            if (gpu_budget_mb < MEMORY_MIN_BUDGET_MB || gpu_budget_mb > MEMORY_MAX_BUDGET_MB) {
+                SDL_Log("--gpu-budget must be between %d and %ld MiB", MEMORY_MIN_BUDGET_MB, MEMORY_MAX_BUDGET_MB);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--json") == 0) {
+            scan_json = 1;
+        } else if (strcmp(argv[i], "--thumbnails") == 0) {
+            scan_thumbnails = 1;
+        } else if (!image_path) {
+            image_path = argv[i];
+        }
+    }
+
+    if (bench_directory && validate_filepath(bench_directory) != SECURITY_OK) {
+        SDL_Log("Security error: Invalid benchmark directory");
+        return 1;
+    }
+    if (slideshow_directory && validate_filepath(slideshow_directory) != SECURITY_OK) {
+        SDL_Log("Security error: Invalid slideshow directory");
+        return 1;
+    }
+
+    // Batch mode never initialises video: no window, no renderer
+    if (scan_directory_path) {
+        if (validate_filepath(scan_directory_path) != SECURITY_OK) {
+            SDL_Log("Security error: Invalid scan directory");
+            return 1;
+        }
+        return run_scan(scan_directory_path, scan_jobs, scan_json, scan_thumbnails, (size_t)cpu_budget_mb);
+    }
+
+    memory_budget_init(&app.memory, (size_t)cpu_budget_mb, (size_t)gpu_budget_mb);
     if (!initialize_sdl(&app)) {
         return 1;
     }
 
-    if (argc > 1) {
-        SecurityResult sec_result = validate_filepath(argv[1]);
+    if (bench_directory) {
+        int status = run_benchmark(&app, bench_directory, bench_frames);
+        cleanup(&app);
+        return status;
+    }
+
+    if (slideshow_directory) {
+        if (!slideshow_start(&app, slideshow_directory, (Uint32)slideshow_interval, (Uint32)slideshow_crossfade)) {
+            cleanup(&app);
+            return 1;
+        }
+    } else if (image_path) {
+        SecurityResult sec_result = validate_filepath(image_path);
         if (sec_result != SECURITY_OK) {
             SDL_Log("Security error: Invalid file path");
             cleanup(&app);
             return 1;
         }
 
-        if (!load_image(&app, argv[1])) {
+        if (!load_image(&app, image_path)) {
             SDL_Log("Failed to load specified image. Starting with empty viewer.");
-        } else {
-            extract_metadata(argv[1], &metadata);
+        }
+
+        if (directory_index_scan(&app.directory, image_path)) {
+            SDL_Log("Indexed %d images in folder", app.directory.count);
         }
     } else {
         SDL_Log("Photon started - No image specified. Use command line argument to load an image.");
-        SDL_Log("Controls: ESC=Exit, +/-=Zoom, F=Fit, 1=Actual Size, I=Toggle Info");
+        SDL_Log("Controls: ESC=Exit, +/-=Zoom, F=Fit, 1=Actual Size, I=Toggle Info, S=Stats, G=Grid, "
+                "Left/Right=Browse Folder");
     }
 
     SDL_Log("Press ESC to exit");
 
     while (app.running) {
-        handle_events(&app);
-        render(&app);
-        if (app.show_info && app.image_texture) {
-            render_metadata_overlay(&app, &metadata);
+        handle_events(&app, next_wake_ms(&app));
+        drain_loader_results(&app, UPLOAD_BUDGET_MS);
+        directory_watch_update(&app);
+        update_view_animation(&app);
+        view_check_resolution(&app);
+        animation_player_update(&app);
+        slideshow_update(&app);
+        if (!app.needs_redraw) {
+            continue;
         }
+
+        app.needs_redraw = 0;
+        render(&app);
     }
 
-    secure_memzero(&metadata, sizeof(metadata));
+    slideshow_report(&app.slideshow);
+    SDL_RendererInfo renderer_info;
+    stats_write_csv(&app.stats, SDL_GetRendererInfo(app.renderer, &renderer_info) == 0 ? renderer_info.name : NULL);
     cleanup(&app);
     return 0;
 }